@@ -0,0 +1,174 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+//
+// The binary event sink is the event tracing backend used where there is no ETW. Events are written as
+// compact binary records into per-CPU lock-free ring buffers, and a background thread drains the buffers
+// into a file. The GC decides which of its events to fire using the keyword and level state in
+// GCEventStatus, which the sink sets up from the EventSinkKeywords and EventSinkLevel configuration values.
+// The file is named by the RH_EventSinkFile configuration string, rhevents.<pid>.bin when it is not set.
+//
+// File format (all values little endian):
+//
+//   File header
+//     u32  magic                   'RHEV' (0x56454852)
+//     u32  version                 2
+//     u32  pointer size            size in bytes of pointers in the process (payload pointers are always 8 bytes)
+//     u32  event name count
+//     u64  timestamp frequency     timestamp ticks per second
+//     u64  start timestamp
+//     u64  process id
+//     followed by "event name count" entries of
+//       u16  event id
+//       u8   provider              0 = default, 1 = private, 2 = runtime
+//       u8   name length
+//       char name[name length]     not NUL terminated
+//
+//   Event records, each 8 byte aligned
+//     u32  record size             including this header and the padding at the end
+//     u16  event id
+//     u16  cpu
+//     u32  thread id
+//     u32  payload size
+//     u64  timestamp
+//     u8   payload[payload size]   the event arguments in declaration order, pointers and size_t widened to u64
+//
+// When events have to be dropped because a ring buffer is full, the drain thread writes an EventsLost
+// record whose payload is the u64 number of events lost on the CPU in the record header since the last
+// EventsLost record for that CPU.
+//
+// GCAllocationTick_V3 records have the type id of the allocated object, the address of its EEType, appended
+// to the GC's arguments. The allocating thread writes a TypeInfo record before the first allocation tick it
+// writes for a type, so that type ids can be resolved offline (other threads may write the same TypeInfo):
+//     u64  type id
+//     u64  module base             0 if the EEType is not in a module
+//     u32  base size
+//     u32  component size
+//     u32  module path length, followed by the module path
+// The type id minus the module base is the offset of the EEType in the module, which is what the symbols of
+// the module's EETypes can be looked up by.
+//
+
+#ifdef FEATURE_BINARY_EVENT_SINK
+
+enum BinaryEventId : uint16_t
+{
+    BinaryEventId_EventsLost,
+
+#define KNOWN_EVENT(name, provider, level, keyword) BinaryEventId_##name,
+#include "gcevents.h"
+
+    BinaryEventId_SuspendEEBegin,
+    BinaryEventId_SuspendEEEnd,
+    BinaryEventId_RestartEEBegin,
+    BinaryEventId_RestartEEEnd,
+    BinaryEventId_TypeInfo,
+
+    BinaryEventId_Count
+};
+
+// A variable length argument, written into the payload as a u32 length followed by the bytes.
+struct BinaryEventBlob
+{
+    const void* data;
+    uint32_t size;
+};
+
+inline uint32_t BinaryEventFieldSize(uint8_t) { return sizeof(uint8_t); }
+inline uint32_t BinaryEventFieldSize(uint16_t) { return sizeof(uint16_t); }
+inline uint32_t BinaryEventFieldSize(uint32_t) { return sizeof(uint32_t); }
+inline uint32_t BinaryEventFieldSize(int32_t) { return sizeof(int32_t); }
+inline uint32_t BinaryEventFieldSize(uint64_t) { return sizeof(uint64_t); }
+template <typename T>
+inline uint32_t BinaryEventFieldSize(T*) { return sizeof(uint64_t); }
+inline uint32_t BinaryEventFieldSize(BinaryEventBlob blob) { return sizeof(uint32_t) + blob.size; }
+
+template <typename T>
+inline uint8_t* BinaryEventWriteField(uint8_t* pDest, T value)
+{
+    memcpy(pDest, &value, sizeof(T));
+    return pDest + sizeof(T);
+}
+
+template <typename T>
+inline uint8_t* BinaryEventWriteField(uint8_t* pDest, T* value)
+{
+    return BinaryEventWriteField(pDest, static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value)));
+}
+
+inline uint8_t* BinaryEventWriteField(uint8_t* pDest, BinaryEventBlob blob)
+{
+    pDest = BinaryEventWriteField(pDest, blob.size);
+    memcpy(pDest, blob.data, blob.size);
+    return pDest + blob.size;
+}
+
+inline uint32_t BinaryEventPayloadSize()
+{
+    return 0;
+}
+
+template <typename T, typename... Rest>
+inline uint32_t BinaryEventPayloadSize(T first, Rest... rest)
+{
+    return BinaryEventFieldSize(first) + BinaryEventPayloadSize(rest...);
+}
+
+inline void BinaryEventWritePayload(uint8_t*)
+{
+}
+
+template <typename T, typename... Rest>
+inline void BinaryEventWritePayload(uint8_t* pDest, T first, Rest... rest)
+{
+    BinaryEventWritePayload(BinaryEventWriteField(pDest, first), rest...);
+}
+
+class BinaryEventSink
+{
+    static bool s_enabled;
+
+    // Reserves space for an event with the given payload size in the current CPU's ring buffer and fills
+    // in the record header. Returns the payload address, or nullptr if the buffer is full.
+    static uint8_t* BeginEvent(BinaryEventId eventId, uint32_t payloadSize);
+
+    // Publishes an event reserved by BeginEvent to the drain thread.
+    static void EndEvent(uint8_t* pPayload);
+
+public:
+    // Starts the sink if any keywords are given. Called once at startup before the GC is initialized so
+    // that events fired during GC initialization are captured. Failing to start the sink is not fatal.
+    static void Initialize(uint32_t keywords, uint32_t level, uint32_t bufferSizeKB);
+
+    static bool IsEnabled()
+    {
+        return s_enabled;
+    }
+
+    template <typename... Args>
+    static void WriteEvent(BinaryEventId eventId, Args... args)
+    {
+        uint32_t payloadSize = BinaryEventPayloadSize(args...);
+        uint8_t* pPayload = BeginEvent(eventId, payloadSize);
+        if (pPayload != nullptr)
+        {
+            BinaryEventWritePayload(pPayload, args...);
+            EndEvent(pPayload);
+        }
+    }
+};
+
+#define BINARY_EVENT(name, ...)                                              \
+    do                                                                       \
+    {                                                                        \
+        if (BinaryEventSink::IsEnabled())                                    \
+            BinaryEventSink::WriteEvent(BinaryEventId_##name, ##__VA_ARGS__); \
+    } while (0)
+
+#else // FEATURE_BINARY_EVENT_SINK
+
+#define BINARY_EVENT(name, ...)
+
+#endif // FEATURE_BINARY_EVENT_SINK
@@ -34,6 +34,7 @@
 #include "eetype.inl"
 
 #include "CachedInterfaceDispatch.h"
+#include "RuntimeCounters.h"
 
 // We always allocate cache sizes with a power of 2 number of entries. We have a maximum size we support,
 // defined below.
@@ -448,6 +449,9 @@ bool InitializeInterfaceDispatch()
 
 COOP_PINVOKE_HELPER(PTR_Code, RhpUpdateDispatchCellCache, (InterfaceDispatchCell * pCell, PTR_Code pTargetCode, EEType* pInstanceType, DispatchCellInfo *pNewCellInfo))
 {
+    // This is only called once the dispatch has been resolved after a cache miss.
+    RUNTIME_COUNTER_INC(dispatchCacheMisses);
+
     // Attempt to update the cache with this new mapping (if we have any cache at all, the initial state
     // is none).
     InterfaceDispatchCache * pCache = (InterfaceDispatchCache*)pCell->GetCache();
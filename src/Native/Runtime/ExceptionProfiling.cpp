@@ -0,0 +1,115 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Totals and sampled records of the exception dispatches timed by ExceptionHandling.cs (see
+// ExceptionProfiling.h).
+//
+
+#include "common.h"
+#include "gcenv.h"
+#include "PalRedhawkCommon.h"
+#include "PalRedhawk.h"
+#include "rhassert.h"
+#include "ExceptionProfiling.h"
+
+#define EXCEPTION_KIND_HARDWARE_FAULT   2
+#define EXCEPTION_KIND_RETHROW_FLAG     4
+
+// A slot of the sample ring. The sequence is the index of the dispatch in the slot plus one, and is 0 while
+// the record is being written, so that readers can tell a torn copy apart.
+struct ExceptionSampleSlot
+{
+    volatile UInt64         sequence;
+    ExceptionDispatchRecord record;
+};
+
+static bool s_exceptionProfilingEnabled = false;
+static UInt32 s_exceptionSampleRate = 1;
+static ExceptionProfileStats s_exceptionStats;
+static ExceptionSampleSlot s_exceptionSamples[EXCEPTION_PROFILE_SAMPLE_COUNT];
+
+void ExceptionProfiling::Initialize(bool enabled, UInt32 sampleRate)
+{
+    LARGE_INTEGER frequency;
+    PalQueryPerformanceFrequency(&frequency);
+    s_exceptionStats.tickFrequency = frequency.QuadPart;
+
+    s_exceptionSampleRate = (sampleRate != 0) ? sampleRate : 1;
+    s_exceptionProfilingEnabled = enabled;
+}
+
+// Returns the current time in PalQueryPerformanceCounter ticks, or 0 if exception dispatches are not being
+// profiled, in which case the dispatcher does not record anything.
+COOP_PINVOKE_HELPER(UInt64, RhpGetExceptionProfilingTimestamp, ())
+{
+    if (!s_exceptionProfilingEnabled)
+        return 0;
+
+    LARGE_INTEGER timeStamp;
+    PalQueryPerformanceCounter(&timeStamp);
+    return timeStamp.QuadPart;
+}
+
+COOP_PINVOKE_HELPER(void, RhpRecordExceptionDispatch, (ExceptionDispatchRecord* pRecord))
+{
+    ASSERT(s_exceptionProfilingEnabled);
+
+    UInt64 dispatchIndex = Interlocked::ExchangeAdd64(&s_exceptionStats.dispatchCount, (UInt64)1);
+    if ((pRecord->kind & EXCEPTION_KIND_RETHROW_FLAG) != 0)
+        Interlocked::ExchangeAdd64(&s_exceptionStats.rethrowCount, (UInt64)1);
+    if ((pRecord->kind & EXCEPTION_KIND_HARDWARE_FAULT) != 0)
+        Interlocked::ExchangeAdd64(&s_exceptionStats.hardwareFaultCount, (UInt64)1);
+    Interlocked::ExchangeAdd64(&s_exceptionStats.pass1FrameCount, (UInt64)pRecord->pass1FrameCount);
+    Interlocked::ExchangeAdd64(&s_exceptionStats.pass2FrameCount, (UInt64)pRecord->pass2FrameCount);
+    Interlocked::ExchangeAdd64(&s_exceptionStats.funcletCount, (UInt64)pRecord->funcletCount);
+    Interlocked::ExchangeAdd64(&s_exceptionStats.pass1Ticks, pRecord->pass1Ticks);
+    Interlocked::ExchangeAdd64(&s_exceptionStats.pass2Ticks, pRecord->pass2Ticks);
+
+    if ((dispatchIndex % s_exceptionSampleRate) != 0)
+        return;
+
+    LARGE_INTEGER timeStamp;
+    PalQueryPerformanceCounter(&timeStamp);
+    pRecord->threadId = PalGetCurrentThreadIdForLogging();
+    pRecord->timeStamp = timeStamp.QuadPart;
+
+    UInt64 sampleIndex = Interlocked::ExchangeAdd64(&s_exceptionStats.sampleCount, (UInt64)1);
+    ExceptionSampleSlot* pSlot = &s_exceptionSamples[sampleIndex % EXCEPTION_PROFILE_SAMPLE_COUNT];
+
+    pSlot->sequence = 0;
+    PalMemoryBarrier();
+    pSlot->record = *pRecord;
+    PalMemoryBarrier();
+    pSlot->sequence = sampleIndex + 1;
+}
+
+// Copies the totals to pStats and up to sampleCount of the most recent sampled dispatches, newest first, to
+// pSamples. Returns the number of samples copied. Samples that are overwritten while they are being copied
+// are left out.
+COOP_PINVOKE_HELPER(Int32, RhGetExceptionProfile, (ExceptionProfileStats* pStats, ExceptionDispatchRecord* pSamples, Int32 sampleCount))
+{
+    *pStats = s_exceptionStats;
+
+    UInt64 lastSample = s_exceptionStats.sampleCount;
+    UInt64 availableCount = (lastSample < EXCEPTION_PROFILE_SAMPLE_COUNT) ? lastSample : EXCEPTION_PROFILE_SAMPLE_COUNT;
+
+    Int32 copiedCount = 0;
+    for (UInt64 i = 0; i < availableCount && copiedCount < sampleCount; i++)
+    {
+        UInt64 sequence = lastSample - i;
+        ExceptionSampleSlot* pSlot = &s_exceptionSamples[(sequence - 1) % EXCEPTION_PROFILE_SAMPLE_COUNT];
+
+        if (pSlot->sequence != sequence)
+            continue;
+        PalMemoryBarrier();
+        pSamples[copiedCount] = pSlot->record;
+        PalMemoryBarrier();
+        if (pSlot->sequence != sequence)
+            continue;
+
+        copiedCount++;
+    }
+
+    return copiedCount;
+}
@@ -0,0 +1,57 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+//
+// Exception dispatch profiling. When RH_ExceptionProfiling is set, the dispatcher in ExceptionHandling.cs times
+// both passes of every exception it dispatches to a catch handler and counts the frames each pass walks and
+// the finally/fault funclets the second pass calls. The totals are kept in ExceptionProfileStats, and every
+// RH_ExceptionProfilingSampleRate'th dispatch (every one when left unspecified) is also recorded in a ring of
+// the last EXCEPTION_PROFILE_SAMPLE_COUNT dispatches. Both can be read with RhGetExceptionProfile.
+//
+// Unhandled exceptions are not recorded, they fail fast at the end of the first pass. Times are in
+// PalQueryPerformanceCounter ticks, see ExceptionProfileStats::tickFrequency.
+//
+
+#define EXCEPTION_PROFILE_SAMPLE_COUNT 256
+
+class EEType;
+
+// One dispatched exception. Keep in sync with ExceptionDispatchRecord in ExceptionHandling.cs.
+struct ExceptionDispatchRecord
+{
+    void*       throwIP;            // IP the exception was thrown or the hardware fault happened at
+    void*       catchIP;            // IP in the frame that caught the exception
+    void*       handlerIP;          // start of the catch funclet
+    EEType*     pExceptionType;
+    UInt32      kind;               // ExKind of the ExInfo, e.g. 1 = throw, 2 = hardware fault, | 4 for a rethrow
+    UInt32      pass1FrameCount;    // frames the first pass walked, including the catching one
+    UInt32      pass2FrameCount;    // frames the second pass walked, including the catching one
+    UInt32      funcletCount;       // finally and fault funclets the second pass called
+    UInt64      pass1Ticks;
+    UInt64      pass2Ticks;         // including the time spent in the funclets, but not in the catch funclet
+    UInt64      threadId;           // filled in by the runtime
+    UInt64      timeStamp;          // filled in by the runtime, when the dispatch was recorded
+};
+
+// Totals over all the recorded dispatches.
+struct ExceptionProfileStats
+{
+    UInt64      tickFrequency;      // PalQueryPerformanceCounter ticks per second
+    UInt64      dispatchCount;
+    UInt64      rethrowCount;
+    UInt64      hardwareFaultCount;
+    UInt64      pass1FrameCount;
+    UInt64      pass2FrameCount;
+    UInt64      funcletCount;
+    UInt64      pass1Ticks;
+    UInt64      pass2Ticks;
+    UInt64      sampleCount;        // number of dispatches recorded in the sample ring so far
+};
+
+class ExceptionProfiling
+{
+public:
+    static void Initialize(bool enabled, UInt32 sampleRate);
+};
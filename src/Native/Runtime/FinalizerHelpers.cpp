@@ -23,15 +23,38 @@
 #include "thread.inl"
 
 #include "yieldprocessornormalized.h"
+#include "RuntimeCounters.h"
 
 GPTR_DECL(Thread, g_pFinalizerThread);
 
 CLREventStatic g_FinalizerEvent;
 CLREventStatic g_FinalizerDoneEvent;
 
+// Set by the low memory watcher thread when the OS reports memory pressure, consumed by the finalizer thread.
+static volatile Int32 g_fLowMemoryPending;
+
 // Finalizer method implemented by redhawkm.
 extern "C" void __cdecl ProcessFinalizers();
 
+// Thread that waits for the OS to report memory pressure and asks the finalizer thread to collect. If the
+// collection is not sufficient to remove the pressure we'll keep being notified, but looping doing cpu intensive
+// collections won't help the situation at all and could make it worse. So after each notification we wait at
+// least two seconds (the CLR value) before reporting the next one.
+static UInt32 WINAPI LowMemoryWatcherStart(void* pContext)
+{
+    UNREFERENCED_PARAMETER(pContext);
+
+    while (GCToOSInterface::WaitForMemoryPressure(INFINITE))
+    {
+        Interlocked::Exchange(&g_fLowMemoryPending, 1);
+        g_FinalizerEvent.Set();
+
+        PalSleep(2000);
+    }
+
+    return 0;
+}
+
 // Unmanaged front-end to the finalizer thread. We require this because at the point the GC creates the
 // finalizer thread we're still executing the DllMain for RedhawkU. At that point we can't run managed code
 // successfully (in particular module initialization code has not run for RedhawkM). Instead this method waits
@@ -62,6 +85,11 @@ UInt32 WINAPI FinalizerStart(void* pContext)
     UInt32_BOOL fResult = PalSetEvent(hFinalizerEvent);
     ASSERT(fResult);
 
+    // Everything is up and running now so low memory notifications can make us collect. We can live without
+    // them, so failing to start the watcher is not fatal.
+    if (GCToOSInterface::CanWaitForMemoryPressure())
+        PalStartBackgroundGCThread(LowMemoryWatcherStart, NULL);
+
     // Run the managed portion of the finalizer. Until we implement (non-process) shutdown this call will
     // never return.
 
@@ -173,57 +201,22 @@ EXTERN_C REDHAWK_API void __cdecl RhWaitForPendingFinalizers(UInt32_BOOL allowRe
 // (returns false and the finalizer thread should initiate a garbage collection).
 EXTERN_C REDHAWK_API UInt32_BOOL __cdecl RhpWaitForFinalizerRequest()
 {
-    // We can wait for two events; finalization queue has been populated and low memory resource notification.
-    // But if the latter is signalled we shouldn't wait on it again immediately -- if the garbage collection
-    // the finalizer thread initiates as a result is not sufficient to remove the low memory condition the
-    // event will still be signalled and we'll end up looping doing cpu intensive collections, which won't
-    // help the situation at all and could make it worse. So we remember whether the last event we reported
-    // was low memory and if so we'll wait at least two seconds (the CLR value) on just a finalization
-    // request.
-    static bool fLastEventWasLowMemory = false;
-
-    IGCHeap * pHeap = GCHeapUtilities::GetGCHeap();
-
-    // Wait in a loop because we may have to retry if we decide to only wait for finalization events but the
-    // two second timeout expires.
-    do
+    // The low memory watcher thread wakes us through the finalization event and tells us it was about low
+    // memory through g_fLowMemoryPending. It also limits how often that happens so we don't end up looping
+    // doing cpu intensive collections when they don't help.
+    UInt32 uResult = PalWaitForSingleObjectEx(g_FinalizerEvent.GetOSEvent(), INFINITE, FALSE);
+    ASSERT(uResult == WAIT_OBJECT_0);
+
+    if (Interlocked::Exchange(&g_fLowMemoryPending, 0) != 0)
     {
-        HANDLE  lowMemEvent = NULL;
-#if 0 // TODO: hook up low memory notification
-        lowMemEvent = pHeap->GetLowMemoryNotificationEvent();
-        HANDLE  rgWaitHandles[] = { g_FinalizerEvent.GetOSEvent(), lowMemEvent };
-        UInt32  cWaitHandles = (fLastEventWasLowMemory || (lowMemEvent == NULL)) ? 1 : 2;
-        UInt32  uTimeout = fLastEventWasLowMemory ? 2000 : INFINITE;
-
-        UInt32 uResult = PalWaitForMultipleObjectsEx(cWaitHandles, rgWaitHandles, FALSE, uTimeout, FALSE);
-#else
-        UInt32 uResult = PalWaitForSingleObjectEx(g_FinalizerEvent.GetOSEvent(), INFINITE, FALSE);
-#endif
+        // Memory is low, tell the finalizer thread to garbage collect. The event is auto-reset so we may have
+        // consumed a finalization request as well - set it again so the next wait picks that up.
+        g_FinalizerEvent.Set();
+        return FALSE;
+    }
 
-        switch (uResult)
-        {
-        case WAIT_OBJECT_0:
-            // At least one object is ready for finalization.
-            return TRUE;
-
-        case WAIT_OBJECT_0 + 1:
-            // Memory is low, tell the finalizer thread to garbage collect.
-            ASSERT(!fLastEventWasLowMemory);
-            fLastEventWasLowMemory = true;
-            return FALSE;
-
-        case WAIT_TIMEOUT:
-            // We were waiting only for finalization events but didn't get one within the timeout period. Go
-            // back to waiting for any event.
-            ASSERT(fLastEventWasLowMemory);
-            fLastEventWasLowMemory = false;
-            break;
-
-        default:
-            ASSERT(!"Unexpected PalWaitForMultipleObjectsEx() result");
-            return FALSE;
-        }
-    } while (true);
+    // At least one object is ready for finalization.
+    return TRUE;
 }
 
 // Indicate that the current round of finalizations is complete.
@@ -247,6 +240,9 @@ COOP_PINVOKE_HELPER(OBJECTREF, RhpGetNextFinalizableObject, ())
         if (refNext == NULL)
             return NULL;
 
+        RUNTIME_COUNTER_DEC(finalizationQueueLength);
+        RUNTIME_COUNTER_INC(finalizedObjectCount);
+
         // The queue may contain objects which have been marked as finalized already (via GC.SuppressFinalize()
         // for instance). Skip finalization for these but reset the flag so that the object can be put back on
         // the list with RegisterForFinalization().
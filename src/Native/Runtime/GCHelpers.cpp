@@ -10,6 +10,8 @@
 #include "gcenv.ee.h"
 #include "gcheaputilities.h"
 #include "RestrictedCallouts.h"
+#include "gchandleutilities.h"
+#include "RuntimeCounters.h"
 
 #include "gcrhinterface.h"
 
@@ -40,6 +42,58 @@ EXTERN_C REDHAWK_API void __cdecl RhpCollect(UInt32 uGeneration, UInt32 uMode)
     pCurThread->EnablePreemptiveMode();
 }
 
+// A low memory notification this soon after the previous low memory collection means that collection did not
+// relieve the pressure. The watcher reports at most one notification every 2 seconds.
+#define LOW_MEMORY_ESCALATION_WINDOW_MS     10000
+
+// Minimum time between two full low memory collections, so that pressure the GC can't do anything about (such as
+// the page cache of a process doing a lot of file I/O) doesn't turn into back to back full blocking GCs.
+#define LOW_MEMORY_FULL_GC_MIN_INTERVAL_MS  60000
+
+// Only used on the finalizer thread.
+static bool s_fLowMemoryCollectionDone = false;
+static bool s_fLowMemoryFullCollectionDone = false;
+static int s_lowMemoryCollectionGeneration;
+static UInt32 s_lowMemoryCollectionTime;
+static UInt32 s_lowMemoryFullCollectionTime;
+
+// Collection the finalizer thread initiates when memory is low. Unlike RhpCollect this tells the GC that memory is
+// low, so it shrinks the gen0 budget and gives the free space back to the OS right away. This starts with a gen1
+// collection, and only does a full blocking collection when the pressure is still there at the next notification.
+EXTERN_C REDHAWK_API void __cdecl RhpCollectForLowMemory()
+{
+    // This must be called via p/invoke rather than RuntimeImport to make the stack crawlable.
+
+    Thread * pCurThread = ThreadStore::GetCurrentThread();
+
+    pCurThread->SetupHackPInvokeTunnel();
+    pCurThread->DisablePreemptiveMode();
+
+    UInt32 now = PalGetTickCount();
+    int generation = 1;
+    if (s_fLowMemoryCollectionDone &&
+        (s_lowMemoryCollectionGeneration == 1) &&
+        ((now - s_lowMemoryCollectionTime) <= LOW_MEMORY_ESCALATION_WINDOW_MS) &&
+        (!s_fLowMemoryFullCollectionDone || ((now - s_lowMemoryFullCollectionTime) >= LOW_MEMORY_FULL_GC_MIN_INTERVAL_MS)))
+    {
+        generation = 2;
+    }
+
+    ASSERT(!pCurThread->IsDoNotTriggerGcSet());
+    GCHeapUtilities::GetGCHeap()->GarbageCollect(generation, TRUE, collection_blocking);
+
+    s_fLowMemoryCollectionDone = true;
+    s_lowMemoryCollectionGeneration = generation;
+    s_lowMemoryCollectionTime = PalGetTickCount();
+    if (generation == 2)
+    {
+        s_fLowMemoryFullCollectionDone = true;
+        s_lowMemoryFullCollectionTime = s_lowMemoryCollectionTime;
+    }
+
+    pCurThread->EnablePreemptiveMode();
+}
+
 EXTERN_C REDHAWK_API Int64 __cdecl RhpGetGcTotalMemory()
 {
     // This must be called via p/invoke rather than RuntimeImport to make the stack crawlable.
@@ -253,6 +307,9 @@ public:
     RH_GC_GENERATION_INFO generationInfo4;
     UInt64 pauseDuration0;
     UInt64 pauseDuration1;
+    UInt64 pinnedPlugCount;
+    UInt64 pinnedPlugSizeBytes;
+    UInt64 pinnedPlugFragmentationBytes;
 };
 #if defined(TARGET_X86) && !defined(TARGET_UNIX)
 #ifdef _MSC_VER
@@ -283,9 +340,136 @@ COOP_PINVOKE_HELPER(void, RhGetMemoryInfo, (RH_GH_MEMORY_INFO* pData, int kind))
         (bool*)&(pData->isConcurrent),
         genInfoRaw,
         pauseInfoRaw,
+        &(pData->pinnedPlugCount),
+        &(pData->pinnedPlugSizeBytes),
+        &(pData->pinnedPlugFragmentationBytes),
         kind);
 }
 
+// Summary of the GC's histogram for one gc_pause_kind. Durations are in microseconds, and each percentile is
+// the largest duration of the histogram bucket it falls in. Keep in sync with GCPauseStatsData in GC.cs.
+struct RH_GC_PAUSE_STATS
+{
+public:
+    UInt64 count;
+    UInt64 totalDuration;
+    UInt64 maxDuration;
+    UInt64 p50Duration;
+    UInt64 p90Duration;
+    UInt64 p99Duration;
+    UInt64 p999Duration;
+};
+
+static UInt64 GetPausePercentile(gc_pause_histogram* pHistogram, UInt64 perMille)
+{
+    UInt64 rank = max((pHistogram->count * perMille + 999) / 1000, (UInt64)1);
+    UInt64 seen = 0;
+
+    for (UInt32 i = 0; i < GC_PAUSE_HISTOGRAM_BUCKETS; i++)
+    {
+        seen += pHistogram->buckets[i];
+        if (seen >= rank)
+            return min(gc_pause_histogram_bucket_limit(i), pHistogram->max_duration);
+    }
+
+    return pHistogram->max_duration;
+}
+
+COOP_PINVOKE_HELPER(void, RhGetGCPauseStats, (Int32 kind, RH_GC_PAUSE_STATS* pStats))
+{
+    if (kind < 0 || kind >= gc_pause_kind_count)
+    {
+        memset(pStats, 0, sizeof(*pStats));
+        return;
+    }
+
+    gc_pause_histogram histogram;
+    GCHeapUtilities::GetGCHeap()->GetPauseHistogram(kind, &histogram);
+
+    pStats->count = histogram.count;
+    pStats->totalDuration = histogram.total_duration;
+    pStats->maxDuration = histogram.max_duration;
+    pStats->p50Duration = (histogram.count != 0) ? GetPausePercentile(&histogram, 500) : 0;
+    pStats->p90Duration = (histogram.count != 0) ? GetPausePercentile(&histogram, 900) : 0;
+    pStats->p99Duration = (histogram.count != 0) ? GetPausePercentile(&histogram, 990) : 0;
+    pStats->p999Duration = (histogram.count != 0) ? GetPausePercentile(&histogram, 999) : 0;
+}
+
+// Gets the number of times the GC flushed the write buffers of the processors running the process's threads,
+// the total and longest time the flushes took in nanoseconds, and the number of flushes that had to fall back
+// from the preferred OS mechanism (membarrier on Linux).
+COOP_PINVOKE_HELPER(void, RhGetFlushProcessWriteBuffersStats, (UInt64* pFlushCount, UInt64* pTotalTimeNs, UInt64* pMaxTimeNs, UInt64* pFallbackCount))
+{
+    GCToOSInterface::GetFlushProcessWriteBuffersStats(pFlushCount, pTotalTimeNs, pMaxTimeNs, pFallbackCount);
+}
+
+// Copies up to bucketCount buckets of the GC's histogram for one gc_pause_kind and returns the number of
+// buckets in the histogram. See gcinterface.h for the bucket boundaries.
+COOP_PINVOKE_HELPER(Int32, RhGetGCPauseHistogram, (Int32 kind, UInt32* pBuckets, Int32 bucketCount))
+{
+    if (kind < 0 || kind >= gc_pause_kind_count)
+    {
+        if (bucketCount > 0)
+            memset(pBuckets, 0, bucketCount * sizeof(UInt32));
+        return 0;
+    }
+
+    gc_pause_histogram histogram;
+    GCHeapUtilities::GetGCHeap()->GetPauseHistogram(kind, &histogram);
+
+    Int32 copyCount = min(bucketCount, (Int32)GC_PAUSE_HISTOGRAM_BUCKETS);
+    if (copyCount > 0)
+        memcpy(pBuckets, histogram.buckets, copyCount * sizeof(UInt32));
+
+    return GC_PAUSE_HISTOGRAM_BUCKETS;
+}
+
+// Copies up to recordCount of the most recent per heap GC history records, oldest first, and returns the number
+// of records copied. Keep gc_history_record in sync with GCHistoryRecordData in GC.cs.
+COOP_PINVOKE_HELPER(Int32, RhGetGCHistory, (gc_history_record* pRecords, Int32 recordCount))
+{
+    return GCHeapUtilities::GetGCHeap()->GetHistory(pRecords, recordCount);
+}
+
+COOP_PINVOKE_HELPER(Int32, RhGetGCJoinStats, (Int32 kind, gc_join_stats* pStats, gc_join_heap_stats* pHeapStats, Int32 heapStatsCount))
+{
+    if (kind < 0 || kind >= gc_join_kind_count)
+    {
+        memset(pStats, 0, sizeof(*pStats));
+        return 0;
+    }
+
+    return GCHeapUtilities::GetGCHeap()->GetJoinStats(kind, pStats, pHeapStats, heapStatsCount);
+}
+
+#ifdef FEATURE_RUNTIME_COUNTERS
+void RuntimeCounters::UpdateAfterGC()
+{
+    RuntimeCountersBlock* pBlock = s_pBlock;
+    if (pBlock == nullptr)
+        return;
+
+    IGCHeap* pHeap = GCHeapUtilities::GetGCHeap();
+
+    RH_GH_MEMORY_INFO info;
+    RhGetMemoryInfo(&info, gc_kind_any);
+
+    pBlock->gcCount = info.index;
+    pBlock->gen0Count = pHeap->CollectionCount(0);
+    pBlock->gen1Count = pHeap->CollectionCount(1);
+    pBlock->gen2Count = pHeap->CollectionCount(2);
+    pBlock->allocatedBytes = pHeap->GetTotalAllocatedBytes() - RedhawkGCInterface::GetDeadThreadsNonAllocBytes();
+    pBlock->promotedBytes = info.promotedBytes;
+    pBlock->heapSizeBytes = info.lastRecordedHeapSizeBytes;
+    pBlock->fragmentedBytes = info.lastRecordedFragmentationBytes;
+    pBlock->committedBytes = info.totalCommittedBytes;
+    pBlock->pinnedObjectCount = info.pinnedObjectCount;
+    pBlock->handleCount = GCHandleUtilities::GetGCHandleManager()->CountHandles();
+    pBlock->gcPauseTimeBasisPoints = info.pauseTimePercent;
+    pBlock->finalizationQueueLength = pHeap->GetNumberOfFinalizable();
+}
+#endif // FEATURE_RUNTIME_COUNTERS
+
 COOP_PINVOKE_HELPER(Int64, RhGetTotalAllocatedBytes, ())
 {
     uint64_t allocated_bytes = GCHeapUtilities::GetGCHeap()->GetTotalAllocatedBytes() - RedhawkGCInterface::GetDeadThreadsNonAllocBytes();
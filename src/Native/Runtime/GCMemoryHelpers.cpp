@@ -13,6 +13,85 @@
 #include "GCMemoryHelpers.h"
 #include "GCMemoryHelpers.inl"
 
+#ifdef FEATURE_GC_SAFE_AVX
+#include <immintrin.h>
+
+// The AVX versions of the GC safe fill and copy loops (see GCMemoryHelpers.inl). They're only called once
+// DetectCPUFeatures has seen AVX support, so they're compiled for AVX regardless of the target the rest of the
+// runtime is built for. 32 byte stores to pointer aligned memory don't tear pointers any more than 16 byte ones do.
+#ifdef _MSC_VER
+#define AVX_FUNCTION
+#else
+#define AVX_FUNCTION __attribute__((target("avx")))
+#endif
+
+AVX_FUNCTION size_t GCSafeFillPointersAvx(UIntNative * memPtr, size_t nPtrs, UIntNative pv)
+{
+    UIntNative * startPtr = memPtr;
+    UIntNative * endPtr = memPtr + nPtrs;
+
+    // align the stores
+    while (!IS_ALIGNED(memPtr, sizeof(__m256i)))
+        *(volatile UIntNative *)memPtr++ = pv;
+
+    __m256i v = _mm256_set1_epi64x((long long)pv);
+    while ((size_t)((UInt8 *)endPtr - (UInt8 *)memPtr) >= sizeof(__m256i))
+    {
+        *(volatile __m256i *)memPtr = v;
+        memPtr += sizeof(__m256i) / sizeof(UIntNative);
+    }
+
+    return memPtr - startPtr;
+}
+
+AVX_FUNCTION size_t GCSafeForwardCopyAvx(void * dest, const void *src, size_t len)
+{
+    UInt8 * dmem = (UInt8 *)dest;
+    UInt8 * smem = (UInt8 *)src;
+    UInt8 * dend = dmem + len;
+
+    // align the stores
+    while (!IS_ALIGNED(dmem, sizeof(__m256i)))
+    {
+        *(size_t *)dmem = *(size_t *)smem;
+        dmem += sizeof(size_t);
+        smem += sizeof(size_t);
+    }
+
+    while ((size_t)(dend - dmem) >= sizeof(__m256i))
+    {
+        *(volatile __m256i *)dmem = _mm256_loadu_si256((const __m256i *)smem);
+        dmem += sizeof(__m256i);
+        smem += sizeof(__m256i);
+    }
+
+    return dmem - (UInt8 *)dest;
+}
+
+AVX_FUNCTION size_t GCSafeBackwardCopyAvx(void * dest, const void *src, size_t len)
+{
+    UInt8 * dmem = (UInt8 *)dest + len;
+    UInt8 * smem = (UInt8 *)src + len;
+
+    // align the stores
+    while (!IS_ALIGNED(dmem, sizeof(__m256i)))
+    {
+        dmem -= sizeof(size_t);
+        smem -= sizeof(size_t);
+        *(size_t *)dmem = *(size_t *)smem;
+    }
+
+    while ((size_t)(dmem - (UInt8 *)dest) >= sizeof(__m256i))
+    {
+        dmem -= sizeof(__m256i);
+        smem -= sizeof(__m256i);
+        *(volatile __m256i *)dmem = _mm256_loadu_si256((const __m256i *)smem);
+    }
+
+    return ((UInt8 *)dest + len) - dmem;
+}
+#endif // FEATURE_GC_SAFE_AVX
+
 // This function clears a piece of memory in a GC safe way.  It makes the guarantee that it will clear memory in at 
 // least pointer sized chunks whenever possible.  Unaligned memory at the beginning and remaining bytes at the end are 
 // written bytewise. We must make this guarantee whenever we clear memory in the GC heap that could contain object 
@@ -2,6 +2,13 @@
 // The .NET Foundation licenses this file to you under the MIT license.
 
 #include "volatile.h"
+#include "IntrinsicConstants.h"
+
+#if defined(HOST_AMD64)
+#include <emmintrin.h>
+#elif defined(HOST_ARM64)
+#include <arm_neon.h>
+#endif
 
 //
 // Unmanaged GC memory helpers
@@ -19,6 +26,163 @@ static const int card_byte_shift = 10;
 #endif
 
 
+//
+// Vector loads and stores used by the GC safe fill and copy helpers below. A vector store to pointer aligned memory
+// writes each pointer sized piece of it atomically (and a vector load reads each piece atomically), so other
+// threads never observe a torn object reference. The stores are volatile to keep the compiler from turning the
+// loops back into memset/memcpy calls, which make no such guarantee.
+//
+#if defined(HOST_AMD64)
+#define GC_SAFE_VECTOR_SIZE 16
+typedef __m128i GCSafeVector;
+FORCEINLINE GCSafeVector GCSafeVectorLoad(const void * p) { return _mm_loadu_si128((const __m128i *)p); }
+FORCEINLINE GCSafeVector GCSafeVectorSplat(UIntNative pv) { return _mm_set1_epi64x((long long)pv); }
+#elif defined(HOST_ARM64)
+#define GC_SAFE_VECTOR_SIZE 16
+typedef uint64x2_t GCSafeVector;
+FORCEINLINE GCSafeVector GCSafeVectorLoad(const void * p) { return vld1q_u64((const uint64_t *)p); }
+FORCEINLINE GCSafeVector GCSafeVectorSplat(UIntNative pv) { return vdupq_n_u64(pv); }
+#endif
+
+#ifdef GC_SAFE_VECTOR_SIZE
+FORCEINLINE void GCSafeVectorStore(void * p, GCSafeVector v)
+{
+    ASSERT(IS_ALIGNED(p, GC_SAFE_VECTOR_SIZE));
+    *(volatile GCSafeVector *)p = v;
+}
+
+// Below this size the scalar loops are just as fast
+static const size_t GCSafeVectorMinSize = 4 * GC_SAFE_VECTOR_SIZE;
+#endif // GC_SAFE_VECTOR_SIZE
+
+#if defined(HOST_AMD64) && !defined(USE_PORTABLE_HELPERS)
+// 32 byte AVX versions of the vector loops, used for larger blocks when the CPU supports AVX. They live in
+// GCMemoryHelpers.cpp since they're compiled for a different target than their callers.
+#define FEATURE_GC_SAFE_AVX
+EXTERN_C int g_cpuFeatures;
+
+static const size_t GCSafeAvxMinSize = 512;
+
+size_t GCSafeFillPointersAvx(UIntNative * memPtr, size_t nPtrs, UIntNative pv);
+size_t GCSafeForwardCopyAvx(void * dest, const void *src, size_t len);
+size_t GCSafeBackwardCopyAvx(void * dest, const void *src, size_t len);
+
+FORCEINLINE bool UseGCSafeAvx(size_t size)
+{
+    return (size >= GCSafeAvxMinSize) && ((g_cpuFeatures & XArchIntrinsicConstants_Avx) != 0);
+}
+#endif // HOST_AMD64 && !USE_PORTABLE_HELPERS
+
+// Fills the bulk of the nPtrs pointer sized slots at memPtr with pv using vector stores and returns how many slots
+// it filled, always a prefix of the range. The caller fills the rest.
+FORCEINLINE size_t InlineGCSafeFillPointersVector(UIntNative * memPtr, size_t nPtrs, UIntNative pv)
+{
+#ifdef GC_SAFE_VECTOR_SIZE
+    if (nPtrs * sizeof(UIntNative) < GCSafeVectorMinSize)
+        return 0;
+
+#ifdef FEATURE_GC_SAFE_AVX
+    if (UseGCSafeAvx(nPtrs * sizeof(UIntNative)))
+        return GCSafeFillPointersAvx(memPtr, nPtrs, pv);
+#endif
+
+    UIntNative * startPtr = memPtr;
+    UIntNative * endPtr = memPtr + nPtrs;
+
+    // align the stores
+    while (!IS_ALIGNED(memPtr, GC_SAFE_VECTOR_SIZE))
+        *(volatile UIntNative *)memPtr++ = pv;
+
+    GCSafeVector v = GCSafeVectorSplat(pv);
+    while ((size_t)((UInt8 *)endPtr - (UInt8 *)memPtr) >= GC_SAFE_VECTOR_SIZE)
+    {
+        GCSafeVectorStore(memPtr, v);
+        memPtr += GC_SAFE_VECTOR_SIZE / sizeof(UIntNative);
+    }
+
+    return memPtr - startPtr;
+#else
+    return 0;
+#endif // GC_SAFE_VECTOR_SIZE
+}
+
+// Copies the bulk of len bytes from src to dest using vector loads and stores, front to back, and returns how many
+// bytes it copied, always a prefix of the range. The caller copies the rest. The regions may overlap as long as
+// dest <= src.
+FORCEINLINE size_t InlineForwardGCSafeCopyVector(void * dest, const void *src, size_t len)
+{
+#ifdef GC_SAFE_VECTOR_SIZE
+    if (len < GCSafeVectorMinSize)
+        return 0;
+
+#ifdef FEATURE_GC_SAFE_AVX
+    if (UseGCSafeAvx(len))
+        return GCSafeForwardCopyAvx(dest, src, len);
+#endif
+
+    UInt8 * dmem = (UInt8 *)dest;
+    UInt8 * smem = (UInt8 *)src;
+    UInt8 * dend = dmem + len;
+
+    // align the stores
+    while (!IS_ALIGNED(dmem, GC_SAFE_VECTOR_SIZE))
+    {
+        *(size_t *)dmem = *(size_t *)smem;
+        dmem += sizeof(size_t);
+        smem += sizeof(size_t);
+    }
+
+    while ((size_t)(dend - dmem) >= GC_SAFE_VECTOR_SIZE)
+    {
+        GCSafeVectorStore(dmem, GCSafeVectorLoad(smem));
+        dmem += GC_SAFE_VECTOR_SIZE;
+        smem += GC_SAFE_VECTOR_SIZE;
+    }
+
+    return dmem - (UInt8 *)dest;
+#else
+    return 0;
+#endif // GC_SAFE_VECTOR_SIZE
+}
+
+// Copies the bulk of len bytes from src to dest using vector loads and stores, back to front, and returns how many
+// bytes it copied, always a suffix of the range. The caller copies the rest. The regions may overlap as long as
+// src <= dest.
+FORCEINLINE size_t InlineBackwardGCSafeCopyVector(void * dest, const void *src, size_t len)
+{
+#ifdef GC_SAFE_VECTOR_SIZE
+    if (len < GCSafeVectorMinSize)
+        return 0;
+
+#ifdef FEATURE_GC_SAFE_AVX
+    if (UseGCSafeAvx(len))
+        return GCSafeBackwardCopyAvx(dest, src, len);
+#endif
+
+    UInt8 * dmem = (UInt8 *)dest + len;
+    UInt8 * smem = (UInt8 *)src + len;
+
+    // align the stores
+    while (!IS_ALIGNED(dmem, GC_SAFE_VECTOR_SIZE))
+    {
+        dmem -= sizeof(size_t);
+        smem -= sizeof(size_t);
+        *(size_t *)dmem = *(size_t *)smem;
+    }
+
+    while ((size_t)(dmem - (UInt8 *)dest) >= GC_SAFE_VECTOR_SIZE)
+    {
+        dmem -= GC_SAFE_VECTOR_SIZE;
+        smem -= GC_SAFE_VECTOR_SIZE;
+        GCSafeVectorStore(dmem, GCSafeVectorLoad(smem));
+    }
+
+    return ((UInt8 *)dest + len) - dmem;
+#else
+    return 0;
+#endif // GC_SAFE_VECTOR_SIZE
+}
+
 // This function fills a piece of memory in a GC safe way.  It makes the guarantee
 // that it will fill memory in at least pointer sized chunks whenever possible.
 // Unaligned memory at the beginning and remaining bytes at the end are written bytewise.
@@ -37,8 +201,9 @@ FORCEINLINE void InlineGCSafeFillMemory(void * mem, size_t size, size_t pv)
     // now write pointer sized pieces
     // volatile ensures that this doesn't get optimized back into a memset call
     size_t nPtrs = (endBytes - memBytes) / sizeof(void *);
-    volatile UIntNative* memPtr = (UIntNative*)memBytes;
-    for (size_t i = 0; i < nPtrs; i++)
+    size_t nVectorPtrs = InlineGCSafeFillPointersVector((UIntNative*)memBytes, nPtrs, pv);
+    volatile UIntNative* memPtr = (UIntNative*)memBytes + nVectorPtrs;
+    for (size_t i = nVectorPtrs; i < nPtrs; i++)
         *memPtr++ = pv;
 
     // handle remaining bytes at the end
@@ -64,6 +229,12 @@ FORCEINLINE void InlineForwardGCSafeCopy(void * dest, const void *src, size_t le
     // regions must be non-overlapping
     ASSERT(dmem <= smem || smem + size <= dmem);
 
+    // copy most of it with vector instructions where we can
+    size_t vectorSize = InlineForwardGCSafeCopyVector(dmem, smem, size);
+    size -= vectorSize;
+    smem += vectorSize;
+    dmem += vectorSize;
+
     // copy 4 pointers at a time 
     while (size >= 4 * sizeof(size_t))
     {
@@ -106,6 +277,12 @@ FORCEINLINE void InlineBackwardGCSafeCopy(void * dest, const void *src, size_t l
     // regions must be non-overlapping
     ASSERT(smem <= dmem || dmem + size <= smem);
 
+    // copy most of it with vector instructions where we can
+    size_t vectorSize = InlineBackwardGCSafeCopyVector(dest, src, size);
+    size -= vectorSize;
+    smem -= vectorSize;
+    dmem -= vectorSize;
+
     // copy 4 pointers at a time 
     while (size >= 4 * sizeof(size_t))
     {
@@ -154,18 +331,6 @@ extern "C" {
 }
 static const UInt32 INVALIDGCVALUE = 0xcccccccd;
 
-FORCEINLINE void InlineWriteBarrier(void * dst, void * ref)
-{
-    if (((uint8_t*)ref >= g_ephemeral_low) && ((uint8_t*)ref < g_ephemeral_high))
-    {
-        // volatile is used here to prevent fetch of g_card_table from being reordered 
-        // with g_lowest/highest_address check above. See comment in code:gc_heap::grow_brick_card_tables.
-        uint8_t* pCardByte = (uint8_t *)VolatileLoadWithoutBarrier(&g_card_table) + ((size_t)dst >> LOG2_CLUMP_SIZE);
-        if (*pCardByte != 0xFF)
-            *pCardByte = 0xFF;
-    }
-}
-
 #ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
 extern "C" uint32_t* g_card_bundle_table;
 #endif // FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
@@ -198,6 +363,35 @@ inline static void SoftwareWriteWatchSetDirtyRegion(void* address, size_t length
 }
 #endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
 
+FORCEINLINE void InlineWriteBarrier(void * dst, void * ref)
+{
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (g_sw_ww_enabled_for_gc_heap)
+    {
+        uint8_t* pWatchByte = g_write_watch_table + ((size_t)dst >> SoftwareWriteWatchAddressToTableByteIndexShift);
+        if (*pWatchByte == 0)
+            *pWatchByte = 0xFF;
+    }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+    if (((uint8_t*)ref >= g_ephemeral_low) && ((uint8_t*)ref < g_ephemeral_high))
+    {
+        // volatile is used here to prevent fetch of g_card_table from being reordered 
+        // with g_lowest/highest_address check above. See comment in code:gc_heap::grow_brick_card_tables.
+        uint8_t* pCardByte = (uint8_t *)VolatileLoadWithoutBarrier(&g_card_table) + ((size_t)dst >> LOG2_CLUMP_SIZE);
+        if (*pCardByte != 0xFF)
+        {
+            *pCardByte = 0xFF;
+
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+            uint8_t* pBundleByte = (uint8_t *)VolatileLoadWithoutBarrier(&g_card_bundle_table) + ((size_t)dst >> card_bundle_byte_shift);
+            if (*pBundleByte != 0xFF)
+                *pBundleByte = 0xFF;
+#endif // FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+        }
+    }
+}
+
 FORCEINLINE void InlineCheckedWriteBarrier(void * dst, void * ref)
 {
     // if the dst is outside of the heap (unboxed value classes) then we
@@ -208,6 +402,35 @@ FORCEINLINE void InlineCheckedWriteBarrier(void * dst, void * ref)
     InlineWriteBarrier(dst, ref);
 }
 
+// Returns true if any of the pointer sized slots in [pSlot, pSlotsEnd) holds a value in the ephemeral range
+// [ephemeralLow, ephemeralLow + ephemeralRange). A single unsigned compare per slot covers both bounds. The slots
+// are checked in fixed size groups without an early exit inside a group, which lets the compiler turn the
+// compares into vector instructions.
+FORCEINLINE bool InlineContainsEphemeralReference(UIntNative* pSlot, UIntNative* pSlotsEnd, UIntNative ephemeralLow, UIntNative ephemeralRange)
+{
+    const size_t slotsPerGroup = 8;
+
+    while ((size_t)(pSlotsEnd - pSlot) >= slotsPerGroup)
+    {
+        UIntNative found = 0;
+        for (size_t i = 0; i < slotsPerGroup; i++)
+            found |= (UIntNative)((pSlot[i] - ephemeralLow) < ephemeralRange);
+
+        if (found != 0)
+            return true;
+
+        pSlot += slotsPerGroup;
+    }
+
+    for (; pSlot < pSlotsEnd; pSlot++)
+    {
+        if ((*pSlot - ephemeralLow) < ephemeralRange)
+            return true;
+    }
+
+    return false;
+}
+
 FORCEINLINE void InlinedBulkWriteBarrier(void* pMemStart, size_t cbMemSize)
 {
     // Check whether the writes were even into the heap. If not there's no card update required.
@@ -271,55 +494,59 @@ FORCEINLINE void InlinedBulkWriteBarrier(void* pMemStart, size_t cbMemSize)
     }
 #endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
 
-    // Compute the starting card address and the number of bytes to write (groups of 8 cards). We could try
-    // for further optimization here using aligned 32-bit writes but there's some overhead in setup required
-    // and additional complexity. It's not clear this is warranted given that a single byte of card table
-    // update already covers 1K of object space (2K on 64-bit platforms). It's also not worth probing that
-    // 1K/2K range to see if any of the pointers appear to be non-ephemeral GC references. Given the size of
-    // the area the chances are high that at least one interesting GC refenence is present.
+    // Rather than dirtying every card over the destination we look at what was written and only set the cards
+    // (groups of 8 cards, 1K of object space or 2K on 64-bit platforms) that hold at least one reference into
+    // the ephemeral generations. Large copies of reference arrays typically hold mostly older objects, and each
+    // card we don't set is one less card the next ephemeral GC has to scan. The destination was just written so
+    // it's usually still in the cache. Other threads may be updating it concurrently, but each of them does its
+    // own write barrier, so whatever we read is either a reference we copied or one that's covered already.
+    // This means callers must pass exactly the range they wrote: references stored outside of it won't get
+    // their cards set.
 
     size_t startAddress = (size_t)pMemStart;
     size_t endAddress = startAddress + cbMemSize;
     size_t startingClump = startAddress >> LOG2_CLUMP_SIZE;
     size_t endingClump = (endAddress + CLUMP_SIZE - 1) >> LOG2_CLUMP_SIZE;
 
-    // calculate the number of clumps to mark (round_up(end) - start)
-    size_t clumpCount = endingClump - startingClump;
+    // References are pointer aligned, so only whole pointer sized slots need to be looked at.
+    UIntNative* pSlot = (UIntNative*)((startAddress + sizeof(UIntNative) - 1) & ~(sizeof(UIntNative) - 1));
+    UIntNative* pSlotsEnd = (UIntNative*)(endAddress & ~(sizeof(UIntNative) - 1));
+
+    // The GC can't run while we're here, so the ephemeral range is stable.
+    UIntNative ephemeralLow = (UIntNative)g_ephemeral_low;
+    UIntNative ephemeralRange = (UIntNative)g_ephemeral_high - ephemeralLow;
+
     // VolatileLoadWithoutBarrier() is used here to prevent fetch of g_card_table from being reordered 
     // with g_lowest/highest_address check at the beginning of this function. 
-    uint8_t* card = ((uint8_t*)VolatileLoadWithoutBarrier(&g_card_table)) + startingClump;
+    uint8_t* pCardTable = (uint8_t*)VolatileLoadWithoutBarrier(&g_card_table);
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+    uint8_t* pBundleTable = (uint8_t*)VolatileLoadWithoutBarrier(&g_card_bundle_table);
+#endif
 
-    // Fill the cards. To avoid cache line thrashing we check whether the cards have already been set before
-    // writing.
-    do
+    for (size_t clump = startingClump; clump < endingClump; clump++)
     {
-        if (*card != 0xff)
-        {
-            *card = 0xff;
-        }
-
-        card++;
-        clumpCount--;
-    }
-    while (clumpCount != 0);
+        UIntNative* pClumpEnd = (UIntNative*)((clump + 1) << LOG2_CLUMP_SIZE);
+        if (pClumpEnd > pSlotsEnd)
+            pClumpEnd = pSlotsEnd;
 
-#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
-    size_t startBundleByte = startAddress >> card_bundle_byte_shift;
-    size_t endBundleByte = (endAddress + (1 << card_bundle_byte_shift) - 1) >> card_bundle_byte_shift;
-    size_t bundleByteCount = endBundleByte - startBundleByte;
+        bool fNeedsCard = InlineContainsEphemeralReference(pSlot, pClumpEnd, ephemeralLow, ephemeralRange);
+        pSlot = pClumpEnd;
 
-    uint8_t* pBundleByte = ((uint8_t*)VolatileLoadWithoutBarrier(&g_card_bundle_table)) + startBundleByte;
+        if (!fNeedsCard)
+            continue;
 
-    do
-    {
-        if (*pBundleByte != 0xFF)
+        // To avoid cache line thrashing we check whether the cards have already been set before writing.
+        uint8_t* pCardByte = pCardTable + clump;
+        if (*pCardByte != 0xFF)
         {
-            *pBundleByte = 0xFF;
-        }
+            *pCardByte = 0xFF;
 
-        pBundleByte++;
-        bundleByteCount--;
-    } while (bundleByteCount != 0);
+#ifdef FEATURE_MANUALLY_MANAGED_CARD_BUNDLES
+            uint8_t* pBundleByte = pBundleTable + (clump >> (card_bundle_byte_shift - card_byte_shift));
+            if (*pBundleByte != 0xFF)
+                *pBundleByte = 0xFF;
 #endif
+        }
+    }
 }
 #endif // DACCESS_COMPILE
@@ -0,0 +1,438 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Implementation of the on-demand heap snapshot (see HeapSnapshot.h for the file format).
+//
+
+#include "common.h"
+#include "gcenv.h"
+#include "gcheaputilities.h"
+#include "gcenv.ee.h"
+#include "PalRedhawkCommon.h"
+#include "gcrhinterface.h"
+#include "slist.h"
+#include "varint.h"
+#include "regdisplay.h"
+#include "StackFrameIterator.h"
+#include "thread.h"
+#include "shash.h"
+#include "RWLock.h"
+#include "RuntimeInstance.h"
+#include "threadstore.h"
+#include "threadstore.inl"
+#include "thread.inl"
+#include "HeapSnapshot.h"
+
+#include <stdio.h>
+
+#define HEAP_SNAPSHOT_MAGIC         0x53484852  // 'RHHS'
+#define HEAP_SNAPSHOT_VERSION       1
+#define HEAP_SNAPSHOT_BUFFER_SIZE   (64 * 1024)
+
+enum HeapSnapshotRecordKind : UInt8
+{
+    HeapSnapshotRecord_End = 0,
+    HeapSnapshotRecord_Module = 1,
+    HeapSnapshotRecord_Type = 2,
+    HeapSnapshotRecord_Node = 3,
+    HeapSnapshotRecord_Root = 4,
+    HeapSnapshotRecord_DependentHandle = 5,
+};
+
+class HeapSnapshotWriter
+{
+    FILE* m_pFile;
+    UInt8* m_pBuffer;
+    UInt32 m_bufferUsed;
+    bool m_failed;
+    bool m_complete;
+
+    MapSHash<EEType*, UInt32> m_typeNumbers;
+    UInt32 m_typeCount;
+    MapSHash<void*, UInt32> m_moduleNumbers;
+    UInt32 m_moduleCount;
+
+    UIntNative m_lastNode;
+    UIntNative m_lastRoot;
+    UInt64 m_nodeCount;
+    UInt64 m_referenceCount;
+    UInt64 m_rootCount;
+
+public:
+    HeapSnapshotWriter()
+        : m_pFile(NULL), m_pBuffer(NULL), m_bufferUsed(0), m_failed(false), m_complete(false),
+          m_typeCount(0), m_moduleCount(0), m_lastNode(0), m_lastRoot(0),
+          m_nodeCount(0), m_referenceCount(0), m_rootCount(0)
+    {
+    }
+
+    ~HeapSnapshotWriter()
+    {
+        Close();
+        delete[] m_pBuffer;
+    }
+
+    bool Open(const char* pszPath)
+    {
+        m_pBuffer = new (nothrow) UInt8[HEAP_SNAPSHOT_BUFFER_SIZE];
+        if (m_pBuffer == NULL)
+            return false;
+
+        m_pFile = fopen(pszPath, "wb");
+        return m_pFile != NULL;
+    }
+
+    // Returns whether a complete snapshot made it to the file.
+    bool Close()
+    {
+        if (m_pFile != NULL)
+        {
+            if (fclose(m_pFile) != 0)
+                m_failed = true;
+            m_pFile = NULL;
+        }
+
+        return m_complete && !m_failed;
+    }
+
+    // Writes the snapshot. Must be called while the runtime is suspended for a GC.
+    void Write();
+
+private:
+    void Flush()
+    {
+        if (m_bufferUsed != 0 && !m_failed)
+        {
+            if (fwrite(m_pBuffer, 1, m_bufferUsed, m_pFile) != m_bufferUsed)
+                m_failed = true;
+        }
+        m_bufferUsed = 0;
+    }
+
+    void WriteByte(UInt8 value)
+    {
+        if (m_bufferUsed == HEAP_SNAPSHOT_BUFFER_SIZE)
+            Flush();
+        m_pBuffer[m_bufferUsed++] = value;
+    }
+
+    void WriteBytes(const void* pData, size_t size)
+    {
+        const UInt8* pBytes = (const UInt8*)pData;
+        for (size_t i = 0; i < size; i++)
+            WriteByte(pBytes[i]);
+    }
+
+    void WriteUInt32(UInt32 value)
+    {
+        WriteBytes(&value, sizeof(value));
+    }
+
+    void WriteUnsigned(UInt64 value)
+    {
+        while (value >= 0x80)
+        {
+            WriteByte((UInt8)(value | 0x80));
+            value >>= 7;
+        }
+        WriteByte((UInt8)value);
+    }
+
+    void WriteSigned(Int64 value)
+    {
+        WriteUnsigned(((UInt64)value << 1) ^ (UInt64)(value >> 63));
+    }
+
+    UInt32 GetModuleNumber(void* pModuleBase);
+    UInt32 GetTypeNumber(EEType* pEEType);
+
+    void WriteNode(Object* pObject);
+    void WriteRoot(Object* pObject, UInt32 rootKind, UInt32 rootFlags);
+    void WriteDependentHandle(Object* pPrimary, Object* pSecondary);
+
+    static bool WalkHeapCallback(Object* pObject, void* pContext);
+    static bool CountReferenceCallback(Object* pReference, void* pContext);
+    static bool WriteReferenceCallback(Object* pReference, void* pContext);
+    static void ScanRootCallback(PTR_PTR_Object ppObject, ScanContext* pSC, uint32_t dwFlags);
+    static void ScanHandleCallback(Object** ppObject, Object* pSecondary, uint32_t dwFlags, ScanContext* pSC, bool isDependent);
+};
+
+struct HeapSnapshotScanContext : public ScanContext
+{
+    HeapSnapshotWriter* pWriter;
+    // EtwGCRootKind of the roots being scanned. ScanContext only has a field for it with event tracing.
+    UInt32 rootKind;
+};
+
+// The snapshot the next blocking gen2 GC should write, set by RhWriteHeapSnapshot.
+static HeapSnapshotWriter* volatile s_pPendingHeapSnapshot = NULL;
+
+// Set while a RhWriteHeapSnapshot call is taking a snapshot, so that a concurrent call fails before it opens,
+// and so truncates, the file.
+static Int32 volatile s_heapSnapshotInProgress = 0;
+
+UInt32 HeapSnapshotWriter::GetModuleNumber(void* pModuleBase)
+{
+    UInt32 moduleNumber;
+    if (m_moduleNumbers.Lookup(pModuleBase, &moduleNumber))
+        return moduleNumber;
+
+    moduleNumber = m_moduleCount++;
+    m_moduleNumbers.Add(pModuleBase, moduleNumber);
+
+    const TCHAR* pName = NULL;
+    Int32 nameLength = PalGetModuleFileName(&pName, pModuleBase);
+    if (pName == NULL || nameLength < 0)
+        nameLength = 0;
+
+    WriteByte(HeapSnapshotRecord_Module);
+    WriteUnsigned((UIntNative)pModuleBase);
+    WriteUnsigned(nameLength * sizeof(TCHAR));
+    WriteBytes(pName, nameLength * sizeof(TCHAR));
+
+    return moduleNumber;
+}
+
+UInt32 HeapSnapshotWriter::GetTypeNumber(EEType* pEEType)
+{
+    UInt32 typeNumber;
+    if (m_typeNumbers.Lookup(pEEType, &typeNumber))
+        return typeNumber;
+
+    // Types are only ever looked up by address, they are resolved to names offline
+    void* pModuleBase = PalGetModuleHandleFromPointer(pEEType);
+    UInt32 moduleNumber = (pModuleBase != NULL) ? GetModuleNumber(pModuleBase) : 0;
+
+    typeNumber = m_typeCount++;
+    m_typeNumbers.Add(pEEType, typeNumber);
+
+    WriteByte(HeapSnapshotRecord_Type);
+    if (pModuleBase != NULL)
+    {
+        WriteUnsigned(moduleNumber + 1);
+        WriteUnsigned((UIntNative)pEEType - (UIntNative)pModuleBase);
+    }
+    else
+    {
+        WriteUnsigned(0);
+        WriteUnsigned((UIntNative)pEEType);
+    }
+    WriteUnsigned(pEEType->get_BaseSize());
+    WriteUnsigned(pEEType->get_ComponentSize());
+
+    return typeNumber;
+}
+
+struct HeapSnapshotReferenceContext
+{
+    HeapSnapshotWriter* pWriter;
+    UIntNative node;
+    size_t count;
+};
+
+bool HeapSnapshotWriter::CountReferenceCallback(Object* /*pReference*/, void* pContext)
+{
+    ((HeapSnapshotReferenceContext*)pContext)->count++;
+    return true;
+}
+
+bool HeapSnapshotWriter::WriteReferenceCallback(Object* pReference, void* pContext)
+{
+    HeapSnapshotReferenceContext* pReferenceContext = (HeapSnapshotReferenceContext*)pContext;
+    pReferenceContext->pWriter->WriteSigned((Int64)((UIntNative)pReference - pReferenceContext->node));
+    return true;
+}
+
+void HeapSnapshotWriter::WriteNode(Object* pObject)
+{
+    UInt32 typeNumber = GetTypeNumber(pObject->get_SafeEEType());
+
+    // References are walked twice, once to count them and once to write them, so that objects with huge
+    // numbers of references don't need a buffer of their own
+    HeapSnapshotReferenceContext referenceContext = { this, (UIntNative)pObject, 0 };
+    GCHeapUtilities::GetGCHeap()->DiagWalkObject(pObject, &CountReferenceCallback, &referenceContext);
+
+    WriteByte(HeapSnapshotRecord_Node);
+    WriteSigned((Int64)((UIntNative)pObject - m_lastNode));
+    WriteUnsigned(typeNumber);
+    WriteUnsigned(pObject->GetSize());
+    WriteUnsigned(referenceContext.count);
+    if (referenceContext.count != 0)
+    {
+        GCHeapUtilities::GetGCHeap()->DiagWalkObject(pObject, &WriteReferenceCallback, &referenceContext);
+    }
+
+    m_lastNode = (UIntNative)pObject;
+    m_nodeCount++;
+    m_referenceCount += referenceContext.count;
+}
+
+void HeapSnapshotWriter::WriteRoot(Object* pObject, UInt32 rootKind, UInt32 rootFlags)
+{
+    WriteByte(HeapSnapshotRecord_Root);
+    WriteUnsigned(rootKind);
+    WriteUnsigned(rootFlags);
+    WriteSigned((Int64)((UIntNative)pObject - m_lastRoot));
+
+    m_lastRoot = (UIntNative)pObject;
+    m_rootCount++;
+}
+
+void HeapSnapshotWriter::WriteDependentHandle(Object* pPrimary, Object* pSecondary)
+{
+    WriteByte(HeapSnapshotRecord_DependentHandle);
+    WriteUnsigned((UIntNative)pPrimary);
+    WriteSigned((Int64)((UIntNative)pSecondary - (UIntNative)pPrimary));
+}
+
+bool HeapSnapshotWriter::WalkHeapCallback(Object* pObject, void* pContext)
+{
+    HeapSnapshotWriter* pWriter = (HeapSnapshotWriter*)pContext;
+    pWriter->WriteNode(pObject);
+
+    // There is no point in walking the rest of the heap once the file can't be written
+    return !pWriter->m_failed;
+}
+
+void HeapSnapshotWriter::ScanRootCallback(PTR_PTR_Object ppObject, ScanContext* pSC, uint32_t dwFlags)
+{
+    HeapSnapshotScanContext* pContext = (HeapSnapshotScanContext*)pSC;
+
+    Object* pObject = *ppObject;
+    if (pObject == NULL)
+        return;
+
+    UInt32 rootFlags = 0;
+    if (dwFlags & GC_CALL_INTERIOR)
+    {
+        // Interior pointers are reported as roots of the object they point into
+        if (pSC->thread_under_crawl != NULL && pSC->thread_under_crawl->IsWithinStackBounds(pObject))
+            return;
+
+        pObject = GCHeapUtilities::GetGCHeap()->GetContainingObject(pObject, false);
+        if (pObject == NULL)
+            return;
+
+        rootFlags |= kEtwGCRootFlagsInterior;
+    }
+    if (dwFlags & GC_CALL_PINNED)
+        rootFlags |= kEtwGCRootFlagsPinning;
+
+    pContext->pWriter->WriteRoot(pObject, pContext->rootKind, rootFlags);
+}
+
+void HeapSnapshotWriter::ScanHandleCallback(Object** ppObject, Object* pSecondary, uint32_t dwFlags, ScanContext* pSC, bool isDependent)
+{
+    HeapSnapshotScanContext* pContext = (HeapSnapshotScanContext*)pSC;
+
+    Object* pObject = *ppObject;
+    if (pObject == NULL)
+        return;
+
+    if (isDependent)
+    {
+        if (pSecondary != NULL)
+            pContext->pWriter->WriteDependentHandle(pObject, pSecondary);
+    }
+    else
+    {
+        pContext->pWriter->WriteRoot(pObject, kEtwGCRootKindHandle, dwFlags);
+    }
+}
+
+void HeapSnapshotWriter::Write()
+{
+    WriteUInt32(HEAP_SNAPSHOT_MAGIC);
+    WriteUInt32(HEAP_SNAPSHOT_VERSION);
+    WriteUInt32(sizeof(void*));
+    WriteUInt32(sizeof(TCHAR));
+
+    IGCHeap* pHeap = GCHeapUtilities::GetGCHeap();
+    int maxGeneration = pHeap->GetMaxGeneration();
+
+    pHeap->DiagWalkHeap(&WalkHeapCallback, this, maxGeneration, true /* walk the large object heap */);
+
+    HeapSnapshotScanContext sc;
+    sc.pWriter = this;
+    sc.promotion = false;
+
+    FOREACH_THREAD(pThread)
+    {
+        // "GC Special" threads are background workers that never have any roots
+        if (pThread->IsGCSpecial())
+            continue;
+
+        sc.thread_under_crawl = pThread;
+        sc.rootKind = kEtwGCRootKindStack;
+        pThread->GcScanRoots(reinterpret_cast<void*>(&ScanRootCallback), &sc);
+    }
+    END_FOREACH_THREAD
+
+    sc.thread_under_crawl = NULL;
+    sc.rootKind = kEtwGCRootKindOther;
+    GetRuntimeInstance()->EnumAllStaticGCRefs(reinterpret_cast<void*>(&ScanRootCallback), &sc);
+
+    sc.rootKind = kEtwGCRootKindFinalizer;
+    pHeap->DiagScanFinalizeQueue(&ScanRootCallback, &sc);
+
+    sc.rootKind = kEtwGCRootKindHandle;
+    pHeap->DiagScanHandles(&ScanHandleCallback, maxGeneration, &sc);
+    pHeap->DiagScanDependentHandles(&ScanHandleCallback, maxGeneration, &sc);
+
+    WriteByte(HeapSnapshotRecord_End);
+    WriteUnsigned(m_nodeCount);
+    WriteUnsigned(m_referenceCount);
+    WriteUnsigned(m_rootCount);
+    Flush();
+
+    m_complete = !m_failed;
+}
+
+void WritePendingHeapSnapshot()
+{
+    if (s_pPendingHeapSnapshot == NULL)
+        return;
+
+    HeapSnapshotWriter* pWriter = (HeapSnapshotWriter*)PalInterlockedExchangePointer((void * volatile *)&s_pPendingHeapSnapshot, NULL);
+    if (pWriter != NULL)
+    {
+        pWriter->Write();
+    }
+}
+
+// Writes a heap snapshot to the given file. Returns whether the snapshot was written completely. Fails
+// without writing anything if another snapshot is being taken at the same time.
+EXTERN_C REDHAWK_API UInt32_BOOL __cdecl RhWriteHeapSnapshot(const char* pszPath)
+{
+    // This must be called via p/invoke rather than RuntimeImport to make the stack crawlable.
+
+    if (PalInterlockedCompareExchange(&s_heapSnapshotInProgress, 1, 0) != 0)
+        return FALSE;
+
+    HeapSnapshotWriter writer;
+    if (!writer.Open(pszPath))
+    {
+        s_heapSnapshotInProgress = 0;
+        return FALSE;
+    }
+
+    s_pPendingHeapSnapshot = &writer;
+
+    Thread * pCurThread = ThreadStore::GetCurrentThread();
+
+    pCurThread->SetupHackPInvokeTunnel();
+    pCurThread->DisablePreemptiveMode();
+
+    ASSERT(!pCurThread->IsDoNotTriggerGcSet());
+    GCHeapUtilities::GetGCHeap()->GarbageCollect(GCHeapUtilities::GetGCHeap()->GetMaxGeneration(), FALSE, collection_blocking);
+
+    pCurThread->EnablePreemptiveMode();
+
+    // Take the request back in case no blocking gen2 GC ended, e.g. because of a no GC region
+    PalInterlockedCompareExchangePointer((void * volatile *)&s_pPendingHeapSnapshot, NULL, &writer);
+
+    UInt32_BOOL result = writer.Close() ? TRUE : FALSE;
+    s_heapSnapshotInProgress = 0;
+    return result;
+}
@@ -0,0 +1,58 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+//
+// On-demand heap snapshots. RhWriteHeapSnapshot induces a blocking gen2 GC and, at the end of that GC while
+// the runtime is still suspended, streams every object on the GC heap with its references, plus the roots,
+// to a file. The writer only holds a fixed size output buffer and the table of types seen so far, so the
+// memory it needs does not depend on the size of the heap.
+//
+// File format (all values little endian):
+//
+//   File header
+//     u32  magic                   'RHHS' (0x53484852)
+//     u32  version                 1
+//     u32  pointer size
+//     u32  module name char size   size in bytes of the characters of module names
+//
+//   Followed by records, each a u8 record kind and its fields. Apart from the record kind all fields are
+//   unsigned LEB128 varints, or zigzag encoded signed LEB128 varints where noted as signed.
+//
+//   Module (1)                     modules are numbered from 0 in the order of their records
+//     base address
+//     name length                  in bytes
+//     u8 name[name length]         not NUL terminated
+//
+//   Type (2)                       types are numbered from 0 in the order of their records, and the record
+//                                  of a type always comes before the first node or root that uses it
+//     module number + 1            0 for types that are not in a module (e.g. created by the type loader)
+//     EEType address               relative to the module base for types in a module
+//     base size
+//     component size
+//
+//   Node (3)                       one for every object on the heap, in heap order
+//     signed  address              relative to the address of the previous node
+//     type number
+//     size
+//     reference count
+//     signed  reference[count]     addresses of the referenced objects, relative to the node address
+//
+//   Root (4)
+//     root kind                    EtwGCRootKind: 0 = stack, 1 = finalizer queue, 2 = handle, 3 = other (statics)
+//     root flags                   EtwGCRootFlags: 1 = pinning, 2 = weak reference, 4 = interior pointer
+//     signed  address              address of the rooted object, relative to the previous root's object
+//
+//   DependentHandle (5)            a dependent handle keeping its secondary object alive for its primary
+//     primary address
+//     signed  secondary address    relative to the primary address
+//
+//   End (0)                        last record of a complete snapshot
+//     node count
+//     reference count
+//     root count
+//
+
+// Writes the snapshot requested by RhWriteHeapSnapshot, if any. Called at the end of each blocking gen2 GC.
+void WritePendingHeapSnapshot();
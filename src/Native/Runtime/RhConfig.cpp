@@ -69,6 +69,31 @@ UInt32 RhConfig::ReadConfigValue(_In_z_ const TCHAR *wszName, UInt32 uiDefaultVa
     return uiResult;
 }
 
+UInt32 RhConfig::ReadConfigString(_In_z_ const TCHAR *wszName, _Out_writes_(cchBuffer) TCHAR* wszBuffer, UInt32 cchBuffer)
+{
+    UInt32 cchResult = 0;
+
+#ifdef FEATURE_ENVIRONMENT_VARIABLE_CONFIG
+    cchResult = PalGetEnvironmentVariable(wszName, wszBuffer, cchBuffer);
+#endif // FEATURE_ENVIRONMENT_VARIABLE_CONFIG
+
+    //the ini and embedded lookups need room for the longest value they can hold
+    if (((cchResult == 0) || (cchResult >= cchBuffer)) && (cchBuffer >= CONFIG_VAL_MAXLEN + 1))
+    {
+        cchResult = GetIniVariable(wszName, wszBuffer, cchBuffer);
+
+#ifdef FEATURE_EMBEDDED_CONFIG
+        if ((cchResult == 0) || (cchResult >= cchBuffer))
+            cchResult = GetEmbeddedVariable(wszName, wszBuffer, cchBuffer);
+#endif // FEATURE_EMBEDDED_CONFIG
+    }
+
+    if ((cchResult == 0) || (cchResult >= cchBuffer))
+        return 0;
+
+    return cchResult;
+}
+
 //reads a config value from rhconfig.ini into outputBuffer buffer returning the length of the value.
 //lazily reads the file so if the file is not yet read, it will read it on first called
 //if the file is not avaliable, or unreadable zero will always be returned
@@ -87,6 +87,12 @@ public:
 #undef DEBUG_CONFIG_VALUE_WITH_DEFAULT
 #undef RETAIL_CONFIG_VALUE_WITH_DEFAULT
 
+    //reads a string config value into wszBuffer returning its length, or zero if the value is not set or
+    //doesn't fit in cchBuffer characters. the environment is searched first, then rhconfig.ini and the
+    //embedded config, which only hold values of up to CONFIG_VAL_MAXLEN characters.
+    //unlike the numeric values above the result is not cached.
+    UInt32 ReadConfigString(_In_z_ const TCHAR *wszName, _Out_writes_(cchBuffer) TCHAR* wszBuffer, UInt32 cchBuffer);
+
 private:
 
     UInt32 ReadConfigValue(_In_z_ const TCHAR *wszName, UInt32 uiDefault);
@@ -18,6 +18,24 @@ RETAIL_CONFIG_VALUE(StressLogLevel)
 RETAIL_CONFIG_VALUE(TotalStressLogSize)
 RETAIL_CONFIG_VALUE(DisableBGC)
 RETAIL_CONFIG_VALUE(UseServerGC)
+RETAIL_CONFIG_VALUE(GCCardMarkingStealingGranularity)   // Size in bytes of the card marking chunks server GC threads can steal from each other
+RETAIL_CONFIG_VALUE(GCFragCompactMaxGen2SizeMB)         // Gen2 live size in MB, summed over all heaps, above which fragmentation alone does not cause a blocking compacting gen2
+RETAIL_CONFIG_VALUE(GCFragCompactCeilingPercent)        // Percentage of gen2 free space that still causes a blocking compacting gen2 past GCFragCompactMaxGen2SizeMB, 50 when left unspecified
+RETAIL_CONFIG_VALUE(GCTHP)                              // Ask the OS to back the GC heap with transparent huge pages (Linux only)
+#if defined(__linux__)
+RETAIL_CONFIG_VALUE_WITH_DEFAULT(GCMemoryPressureNotification, 1) // Collect when the OS reports memory pressure (cgroup v2 PSI or memory.high on Linux)
+#else
+RETAIL_CONFIG_VALUE(GCMemoryPressureNotification)       // Collect when the OS reports memory pressure (low memory resource notification on Windows)
+#endif
+RETAIL_CONFIG_VALUE(GCMemoryPressureStallMs)            // Memory stall time within 2 seconds at which Linux PSI reports memory pressure
+RETAIL_CONFIG_VALUE(GCPreciseCardMarking)               // Have the write barrier mark individual 256 byte cards instead of whole card bytes (x64 Unix only)
+RETAIL_CONFIG_VALUE(EventSinkKeywords)                  // GC event keywords to write to the binary event sink, 0 disables the sink (Unix only)
+RETAIL_CONFIG_VALUE_WITH_DEFAULT(EventSinkLevel, 4)     // Event level for the binary event sink, 5 adds the verbose events such as allocation ticks and joins
+RETAIL_CONFIG_VALUE(EventSinkBufferSizeKB)              // Size in KB of each per-CPU binary event sink buffer, parsed as hex like all the values here (400 = 1 MB), 256 KB when left unspecified
+RETAIL_CONFIG_VALUE(StressLogToFile)                    // Back the stress log with the memory mapped file named by RH_StressLogFile (Linux only)
+RETAIL_CONFIG_VALUE(RuntimeCounters)                    // Keep runtime counters in the shared memory file named by RH_RuntimeCountersFile (Linux only)
+RETAIL_CONFIG_VALUE(ExceptionProfiling)                 // Time and count the frames of each pass of exception dispatch, read with RhGetExceptionProfile
+RETAIL_CONFIG_VALUE(ExceptionProfilingSampleRate)       // Record every Nth profiled exception dispatch in the sample ring, every one when left unspecified
 DEBUG_CONFIG_VALUE(DisallowRuntimeServicesFallback)
 DEBUG_CONFIG_VALUE(GcStressThrottleMode)    // gcstm_TriggerAlways / gcstm_TriggerOnFirstHit / gcstm_TriggerRandom
 DEBUG_CONFIG_VALUE(GcStressFreqCallsite)    // Number of times to force GC out of GcStressFreqDenom (for GCSTM_RANDOM)
@@ -0,0 +1,87 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+#pragma once
+
+//
+// Runtime counters that can be read from outside of the process. When RH_RuntimeCounters is set, the runtime
+// keeps a RuntimeCountersBlock in a shared memory mapped file (RH_RuntimeCountersFile, by default
+// /dev/shm/rhcounters.<pid>) that collectors can map and read without making any calls into the process.
+//
+// The GC related counters are updated at the end of each GC, while the runtime is still suspended. The others
+// are updated as they change. Every counter is a naturally aligned u64 written with a single store, so
+// readers in 64-bit processes never see torn values, but a reader may see the counters of a GC partly
+// updated. The block is only ever extended at the end; readers should check the size field.
+//
+
+#define RUNTIME_COUNTERS_MAGIC      0x43504852  // 'RHPC'
+#define RUNTIME_COUNTERS_VERSION    1
+
+struct RuntimeCountersBlock
+{
+    uint32_t magic;                     // written last, once the rest of the block is initialized
+    uint32_t version;
+    uint32_t size;                      // size of the block in bytes
+    uint32_t reserved;
+    uint64_t processId;
+
+    // Updated at the end of each GC
+    uint64_t gcCount;                   // number of GCs, also the index of the last GC
+    uint64_t gen0Count;                 // number of GCs that collected at least gen0
+    uint64_t gen1Count;                 // number of GCs that collected at least gen1
+    uint64_t gen2Count;                 // number of gen2 GCs, blocking or background
+    uint64_t allocatedBytes;            // total bytes allocated up to the last GC
+    uint64_t promotedBytes;             // bytes that survived the last GC
+    uint64_t heapSizeBytes;             // heap size after the last GC, including fragmentation
+    uint64_t fragmentedBytes;           // free space in the heap after the last GC
+    uint64_t committedBytes;            // memory committed by the GC
+    uint64_t pinnedObjectCount;         // objects pinned during the last GC
+    uint64_t handleCount;               // GC handles in use
+    uint64_t gcPauseTimeBasisPoints;    // time the runtime was paused for GCs since it started, in 1/100ths of a percent
+
+    // Updated as they change
+    uint64_t finalizationQueueLength;   // objects waiting for the finalizer thread to run their finalizer
+    uint64_t finalizedObjectCount;      // objects the finalizer thread has taken off the queue so far
+    uint64_t threadCount;               // threads attached to the runtime
+    uint64_t dispatchCacheMisses;       // interface dispatches that missed their dispatch cell's cache
+};
+
+#ifdef FEATURE_RUNTIME_COUNTERS
+
+class RuntimeCounters
+{
+    static RuntimeCountersBlock* s_pBlock;
+
+public:
+    // Creates the counters file if RH_RuntimeCounters is set. Failing to create it is not fatal, the
+    // counters are just not kept.
+    static void Initialize(bool enabled);
+
+    static RuntimeCountersBlock* GetBlock()
+    {
+        return s_pBlock;
+    }
+
+    // Updates the GC related counters. Called from GcDone at the end of each GC, once the GC has recorded
+    // what RhGetMemoryInfo returns for it. The runtime is not suspended at the end of a background GC.
+    static void UpdateAfterGC();
+};
+
+#define RUNTIME_COUNTER_ADD(name, value)                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        RuntimeCountersBlock* pRuntimeCounters = RuntimeCounters::GetBlock();               \
+        if (pRuntimeCounters != nullptr)                                                    \
+            __atomic_fetch_add(&pRuntimeCounters->name, (uint64_t)(value), __ATOMIC_RELAXED); \
+    } while (0)
+
+#define RUNTIME_COUNTER_INC(name) RUNTIME_COUNTER_ADD(name, 1)
+#define RUNTIME_COUNTER_DEC(name) RUNTIME_COUNTER_ADD(name, -1)
+
+#else // FEATURE_RUNTIME_COUNTERS
+
+#define RUNTIME_COUNTER_ADD(name, value)
+#define RUNTIME_COUNTER_INC(name)
+#define RUNTIME_COUNTER_DEC(name)
+
+#endif // FEATURE_RUNTIME_COUNTERS
@@ -73,6 +73,10 @@ GPTR_IMPL(EEType, g_pFreeObjectEEType);
 #include "DebuggerHook.h"
 
 #include "gctoclreventsink.h"
+#include "BinaryEventSink.h"
+#include "gceventstatus.h"
+#include "HeapSnapshot.h"
+#include "RuntimeCounters.h"
 
 #ifndef DACCESS_COMPILE
 
@@ -800,6 +804,17 @@ void GCToEEInterface::SuspendEE(SUSPEND_REASON reason)
 
     FireEtwGCSuspendEEBegin_V1(Info.SuspendEE.Reason, Info.SuspendEE.GcCount, GetClrInstanceId());
 
+#ifdef FEATURE_BINARY_EVENT_SINK
+    // The suspension events are part of the GC keyword, as they are in the ETW manifest.
+    bool fSuspensionEventsEnabled = GCEventStatus::IsEnabled(GCEventProvider_Default, GCEventKeyword_GC, GCEventLevel_Information);
+    if (fSuspensionEventsEnabled)
+    {
+        UInt32 gcCount = ((reason == SUSPEND_FOR_GC) || (reason == SUSPEND_FOR_GC_PREP)) ?
+            (UInt32)GCHeapUtilities::GetGCHeap()->GetGcCount() : (UInt32)-1;
+        BINARY_EVENT(SuspendEEBegin, (uint32_t)reason, gcCount);
+    }
+#endif // FEATURE_BINARY_EVENT_SINK
+
     g_SuspendEELock.Enter();
 
     GCHeapUtilities::GetGCHeap()->SetGCInProgress(TRUE);
@@ -808,6 +823,11 @@ void GCToEEInterface::SuspendEE(SUSPEND_REASON reason)
 
     FireEtwGCSuspendEEEnd_V1(GetClrInstanceId());
 
+#ifdef FEATURE_BINARY_EVENT_SINK
+    if (fSuspensionEventsEnabled)
+        BINARY_EVENT(SuspendEEEnd);
+#endif // FEATURE_BINARY_EVENT_SINK
+
 #ifdef APP_LOCAL_RUNTIME
     // now is a good opportunity to retry starting the finalizer thread
     RhStartFinalizerThread();
@@ -818,6 +838,12 @@ void GCToEEInterface::RestartEE(bool /*bFinishedGC*/)
 {
     FireEtwGCRestartEEBegin_V1(GetClrInstanceId());
 
+#ifdef FEATURE_BINARY_EVENT_SINK
+    bool fSuspensionEventsEnabled = GCEventStatus::IsEnabled(GCEventProvider_Default, GCEventKeyword_GC, GCEventLevel_Information);
+    if (fSuspensionEventsEnabled)
+        BINARY_EVENT(RestartEEBegin);
+#endif // FEATURE_BINARY_EVENT_SINK
+
 #if defined(TARGET_ARM) || defined(TARGET_ARM64)
     // Flush the store buffers on all CPUs, to ensure that they all see changes made
     // by the GC threads. This only matters on weak memory ordered processors as 
@@ -836,6 +862,11 @@ void GCToEEInterface::RestartEE(bool /*bFinishedGC*/)
     g_SuspendEELock.Leave();
 
     FireEtwGCRestartEEEnd_V1(GetClrInstanceId());
+
+#ifdef FEATURE_BINARY_EVENT_SINK
+    if (fSuspensionEventsEnabled)
+        BINARY_EVENT(RestartEEEnd);
+#endif // FEATURE_BINARY_EVENT_SINK
 }
 
 void GCToEEInterface::GcStartWork(int condemned, int /*max_gen*/)
@@ -861,6 +892,10 @@ void GCToEEInterface::GcDone(int condemned)
 {
     // Invoke any registered callouts for the end of the collection.
     RestrictedCallouts::InvokeGcCallouts(GCRC_EndCollection, condemned);
+
+#ifdef FEATURE_RUNTIME_COUNTERS
+    RuntimeCounters::UpdateAfterGC();
+#endif // FEATURE_RUNTIME_COUNTERS
 }
 
 bool GCToEEInterface::RefCountedHandleCallbacks(Object * pObject)
@@ -1093,12 +1128,16 @@ void GCToEEInterface::DiagWalkFReachableObjects(void* gcContext)
 void GCToEEInterface::DiagGCEnd(size_t index, int gen, int reason, bool fConcurrent)
 {
     UNREFERENCED_PARAMETER(index);
-    UNREFERENCED_PARAMETER(gen);
     UNREFERENCED_PARAMETER(reason);
 
     if (!fConcurrent)
     {
         GCProfileWalkHeap();
+
+        // Only the full GC RhWriteHeapSnapshot induces writes the snapshot, not an ephemeral GC that happens to
+        // end while the request is pending.
+        if (gen == GCHeapUtilities::GetGCHeap()->GetMaxGeneration())
+            WritePendingHeapSnapshot();
     }
 }
 
@@ -1179,14 +1218,155 @@ void GCToEEInterface::DiagWalkBGCSurvivors(void* gcContext)
 #endif // FEATURE_EVENT_TRACE
 }
 
-#if defined(FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP) && (!defined(TARGET_ARM64) || !defined(TARGET_UNIX))
-#error FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP is only implemented for ARM64 and UNIX
+#if defined(FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP) && !((defined(TARGET_AMD64) || defined(TARGET_ARM64)) && defined(TARGET_UNIX))
+#error FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP is only implemented for AMD64 and ARM64 on UNIX
 #endif
 
+#if defined(TARGET_AMD64) && defined(TARGET_UNIX) && !defined(USE_PORTABLE_HELPERS)
+
+// The x64 Unix write barrier entry points end with a jump to a tail that's specialized for the heap layout (see
+// amd64/WriteBarriers.S). We switch between them only while the runtime is suspended and nothing can be executing
+// the jumps we patch. Staying on a tail selected for an older heap layout costs precision but is never incorrect,
+// so changes the GC tells us about while the runtime is running can wait until the next suspension.
+EXTERN_C void RhpWriteBarrierTailGeneric_RSI();
+EXTERN_C void RhpWriteBarrierTailPreGrow_RSI();
+EXTERN_C void RhpWriteBarrierTailPostGrow_RSI();
+EXTERN_C void RhpWriteBarrierTailSvr_RSI();
+EXTERN_C void RhpWriteBarrierTailPreGrowPrecise_RSI();
+EXTERN_C void RhpWriteBarrierTailPostGrowPrecise_RSI();
+EXTERN_C void RhpWriteBarrierTailSvrPrecise_RSI();
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+EXTERN_C void RhpWriteBarrierTailPreGrowWriteWatch_RSI();
+EXTERN_C void RhpWriteBarrierTailPostGrowWriteWatch_RSI();
+EXTERN_C void RhpWriteBarrierTailSvrWriteWatch_RSI();
+EXTERN_C void RhpWriteBarrierTailPreGrowWriteWatchPrecise_RSI();
+EXTERN_C void RhpWriteBarrierTailPostGrowWriteWatchPrecise_RSI();
+EXTERN_C void RhpWriteBarrierTailSvrWriteWatchPrecise_RSI();
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+EXTERN_C void * RhpAssignRefESIPatchLabel;
+EXTERN_C void * RhpCheckedAssignRefESIPatchLabel;
+EXTERN_C void * RhpCheckedLockCmpXchgPatchLabel;
+EXTERN_C void * RhpCheckedXchgPatchLabel;
+
+// The tail all the write barrier entry points currently jump to
+static void * s_pCurrentWriteBarrierTail = (void *)&RhpWriteBarrierTailGeneric_RSI;
+
+// Set once the GC has told us that parts of the heap lie above the ephemeral generation
+static bool s_writeBarrierRequiresUpperBoundsCheck = false;
+
+// Set if we couldn't make the write barrier code writable the first time we tried, in which case the entry
+// points keep jumping to the generic tail, which checks the heap layout and write watch state on every store
+static bool s_writeBarrierPatchingFailed = false;
+
+// Set if the GC asked for the tails that mark single cards rather than whole card bytes
+static bool s_writeBarrierPreciseCardMarking = false;
+
+static void * SelectWriteBarrierTail()
+{
+    bool precise = s_writeBarrierPreciseCardMarking;
+
+#ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+    if (g_sw_ww_enabled_for_gc_heap)
+    {
+        if (g_heap_type == GC_HEAP_SVR)
+            return precise ?
+                (void *)&RhpWriteBarrierTailSvrWriteWatchPrecise_RSI :
+                (void *)&RhpWriteBarrierTailSvrWriteWatch_RSI;
+
+        if (s_writeBarrierRequiresUpperBoundsCheck)
+            return precise ?
+                (void *)&RhpWriteBarrierTailPostGrowWriteWatchPrecise_RSI :
+                (void *)&RhpWriteBarrierTailPostGrowWriteWatch_RSI;
+
+        return precise ?
+            (void *)&RhpWriteBarrierTailPreGrowWriteWatchPrecise_RSI :
+            (void *)&RhpWriteBarrierTailPreGrowWriteWatch_RSI;
+    }
+#endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
+
+    // Server GC has an ephemeral range per heap, so the bounds we're given cover the whole address space.
+    if (g_heap_type == GC_HEAP_SVR)
+        return precise ?
+            (void *)&RhpWriteBarrierTailSvrPrecise_RSI :
+            (void *)&RhpWriteBarrierTailSvr_RSI;
+
+    if (s_writeBarrierRequiresUpperBoundsCheck)
+        return precise ?
+            (void *)&RhpWriteBarrierTailPostGrowPrecise_RSI :
+            (void *)&RhpWriteBarrierTailPostGrow_RSI;
+
+    return precise ?
+        (void *)&RhpWriteBarrierTailPreGrowPrecise_RSI :
+        (void *)&RhpWriteBarrierTailPreGrow_RSI;
+}
+
+// Point the write barrier entry points at the tail that fits the current heap layout. Must only be called while
+// the runtime is suspended.
+static void UpdateWriteBarrierTail()
+{
+    void * pTail = SelectWriteBarrierTail();
+    if ((pTail == s_pCurrentWriteBarrierTail) || s_writeBarrierPatchingFailed)
+        return;
+
+    UInt8 * patchSites[] =
+    {
+        (UInt8 *)&RhpAssignRefESIPatchLabel,
+        (UInt8 *)&RhpCheckedAssignRefESIPatchLabel,
+        (UInt8 *)&RhpCheckedLockCmpXchgPatchLabel,
+        (UInt8 *)&RhpCheckedXchgPatchLabel,
+    };
+    const size_t cbJump = 5; // jmp rel32
+
+    UInt8 * pLowest = patchSites[0];
+    UInt8 * pHighest = patchSites[0];
+    for (size_t i = 1; i < COUNTOF(patchSites); i++)
+    {
+        if (patchSites[i] < pLowest)
+            pLowest = patchSites[i];
+        if (patchSites[i] > pHighest)
+            pHighest = patchSites[i];
+    }
+
+    size_t pageSize = GCToOSInterface::GetPageSize();
+    UInt8 * pStart = (UInt8 *)((UIntNative)pLowest & ~(pageSize - 1));
+    UInt8 * pEnd = (UInt8 *)(((UIntNative)pHighest + cbJump + pageSize - 1) & ~(pageSize - 1));
+
+    // The code stays executable throughout since other threads may be running native code on the same pages.
+    // Hardened systems may not let us make it writable. As long as nothing has been patched yet, the entry
+    // points still jump to the generic tail, which works with any heap layout, so we just stay on it. Once
+    // they jump to a specialized tail, keeping that one after the heap layout or the write watch state
+    // changed would miss card or write watch updates, or read a write watch table that is gone.
+    if (!PalVirtualProtect(pStart, pEnd - pStart, PAGE_EXECUTE_READWRITE))
+    {
+        if (s_pCurrentWriteBarrierTail != (void *)&RhpWriteBarrierTailGeneric_RSI)
+        {
+            ASSERT_UNCONDITIONALLY("Failed to make the write barrier code writable after it was patched");
+            RhFailFast();
+        }
+
+        s_writeBarrierPatchingFailed = true;
+        return;
+    }
+
+    for (size_t i = 0; i < COUNTOF(patchSites); i++)
+    {
+        UInt8 * pSite = patchSites[i];
+        ASSERT(pSite[0] == 0xE9);
+        *(Int32 *)(pSite + 1) = (Int32)((UInt8 *)pTail - (pSite + cbJump));
+    }
+
+    PalVirtualProtect(pStart, pEnd - pStart, PAGE_EXECUTE_READ);
+
+    s_pCurrentWriteBarrierTail = pTail;
+}
+
+#endif // TARGET_AMD64 && TARGET_UNIX && !USE_PORTABLE_HELPERS
+
 void GCToEEInterface::StompWriteBarrier(WriteBarrierParameters* args)
 {
-    // CoreRT doesn't patch the write barrier like CoreCLR does, but it
-    // still needs to record the changes in the GC heap.
+    // Apart from switching between the x64 Unix write barrier tails, CoreRT doesn't patch the write
+    // barrier like CoreCLR does, but it still needs to record the changes in the GC heap.
 
     bool is_runtime_suspended = args->is_runtime_suspended;
 
@@ -1246,6 +1426,14 @@ void GCToEEInterface::StompWriteBarrier(WriteBarrierParameters* args)
             FlushProcessWriteBuffers();
         }
 #endif
+
+#if defined(TARGET_AMD64) && defined(TARGET_UNIX) && !defined(USE_PORTABLE_HELPERS)
+        // If the runtime isn't suspended the barriers keep using the tail they have until the next time it is.
+        if (args->requires_upper_bounds_check)
+            s_writeBarrierRequiresUpperBoundsCheck = true;
+        if (is_runtime_suspended)
+            UpdateWriteBarrierTail();
+#endif
         return;
     case WriteBarrierOp::StompEphemeral:
         // StompEphemeral requires a new ephemeral low and a new ephemeral high
@@ -1253,6 +1441,9 @@ void GCToEEInterface::StompWriteBarrier(WriteBarrierParameters* args)
         assert(args->ephemeral_high != nullptr);
         g_ephemeral_low = args->ephemeral_low;
         g_ephemeral_high = args->ephemeral_high;
+#if defined(TARGET_AMD64) && defined(TARGET_UNIX) && !defined(USE_PORTABLE_HELPERS)
+        UpdateWriteBarrierTail();
+#endif
         return;
     case WriteBarrierOp::Initialize:
         // This operation should only be invoked once, upon initialization.
@@ -1282,6 +1473,10 @@ void GCToEEInterface::StompWriteBarrier(WriteBarrierParameters* args)
         g_highest_address = args->highest_address;
         g_ephemeral_low = args->ephemeral_low;
         g_ephemeral_high = args->ephemeral_high;
+#if defined(TARGET_AMD64) && defined(TARGET_UNIX) && !defined(USE_PORTABLE_HELPERS)
+        s_writeBarrierPreciseCardMarking = args->precise_card_marking;
+        UpdateWriteBarrierTail();
+#endif
         return;
     case WriteBarrierOp::SwitchToWriteWatch:
 #ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
@@ -1289,6 +1484,9 @@ void GCToEEInterface::StompWriteBarrier(WriteBarrierParameters* args)
         assert(args->write_watch_table != nullptr);
         g_write_watch_table = args->write_watch_table;
         g_sw_ww_enabled_for_gc_heap = true;
+#if defined(TARGET_AMD64) && defined(TARGET_UNIX) && !defined(USE_PORTABLE_HELPERS)
+        UpdateWriteBarrierTail();
+#endif
 #else
         assert(!"should never be called without FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP");
 #endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
@@ -1297,8 +1495,12 @@ void GCToEEInterface::StompWriteBarrier(WriteBarrierParameters* args)
     case WriteBarrierOp::SwitchToNonWriteWatch:
 #ifdef FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
         assert(args->is_runtime_suspended && "the runtime must be suspended here!");
-        g_write_watch_table = nullptr;
         g_sw_ww_enabled_for_gc_heap = false;
+#if defined(TARGET_AMD64) && defined(TARGET_UNIX) && !defined(USE_PORTABLE_HELPERS)
+        // Switch to a tail that doesn't touch the table before it goes away.
+        UpdateWriteBarrierTail();
+#endif
+        g_write_watch_table = nullptr;
 #else
         assert(!"should never be called without FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP");
 #endif // FEATURE_USE_SOFTWARE_WRITE_WATCH_FOR_GC_HEAP
@@ -1478,6 +1680,24 @@ bool GCToEEInterface::GetBooleanConfigValue(const char* privateKey, const char*
         return true;
     }
 
+    if (strcmp(privateKey, "GCTHP") == 0)
+    {
+        *value = g_pRhConfig->GetGCTHP() != 0;
+        return true;
+    }
+
+    if (strcmp(privateKey, "GCMemoryPressureNotification") == 0)
+    {
+        *value = g_pRhConfig->GetGCMemoryPressureNotification() != 0;
+        return true;
+    }
+
+    if (strcmp(privateKey, "GCPreciseCardMarking") == 0)
+    {
+        *value = g_pRhConfig->GetGCPreciseCardMarking() != 0;
+        return true;
+    }
+
     return false;
 }
 
@@ -1501,6 +1721,41 @@ bool GCToEEInterface::GetIntConfigValue(const char* privateKey, const char* publ
         return true;
     }
 
+    if (strcmp(privateKey, "GCCardMarkingStealingGranularity") == 0)
+    {
+        *value = g_pRhConfig->GetGCCardMarkingStealingGranularity();
+        return true;
+    }
+
+    if (strcmp(privateKey, "GCFragCompactMaxGen2Size") == 0)
+    {
+        // RhConfig values are limited to 32 bits so this one is specified in MB.
+        *value = (int64_t)g_pRhConfig->GetGCFragCompactMaxGen2SizeMB() * 1024 * 1024;
+        return true;
+    }
+
+    if (strcmp(privateKey, "GCFragCompactCeilingPercent") == 0)
+    {
+        // Zero means not set, leave the GC default in place.
+        UInt32 ceilingPercent = g_pRhConfig->GetGCFragCompactCeilingPercent();
+        if (ceilingPercent == 0)
+            return false;
+
+        *value = ceilingPercent;
+        return true;
+    }
+
+    if (strcmp(privateKey, "GCMemoryPressureStallMs") == 0)
+    {
+        // Zero means not set, leave the GC default in place.
+        UInt32 stallMs = g_pRhConfig->GetGCMemoryPressureStallMs();
+        if (stallMs == 0)
+            return false;
+
+        *value = stallMs;
+        return true;
+    }
+
     return false;
 }
 
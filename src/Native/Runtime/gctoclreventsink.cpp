@@ -3,6 +3,7 @@
 
 #include "common.h"
 #include "gctoclreventsink.h"
+#include "BinaryEventSink.h"
 
 GCToCLREventSink g_gcToClrEventSink;
 
@@ -27,6 +28,8 @@ void GCToCLREventSink::FireGCStart_V2(uint32_t count, uint32_t depth, uint32_t r
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCStart_V2, count, depth, reason, type);
+
 #ifdef FEATURE_ETW
     ETW::GCLog::ETW_GC_INFO gcStartInfo;
     gcStartInfo.GCStart.Count = count;
@@ -41,6 +44,8 @@ void GCToCLREventSink::FireGCGenerationRange(uint8_t generation, void* rangeStar
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCGenerationRange, generation, rangeStart, rangeUsedLength, rangeReservedLength);
+
     FireEtwGCGenerationRange(generation, rangeStart, rangeUsedLength, rangeReservedLength, GetClrInstanceId());
 }
 
@@ -48,6 +53,8 @@ void GCToCLREventSink::FireGCEnd_V1(uint32_t count, uint32_t depth)
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCEnd_V1, count, depth);
+
     FireEtwGCEnd_V1(count, depth, GetClrInstanceId());
 }
 
@@ -70,6 +77,12 @@ void GCToCLREventSink::FireGCHeapStats_V2(
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCHeapStats_V2,
+                 generationSize0, totalPromotedSize0, generationSize1, totalPromotedSize1,
+                 generationSize2, totalPromotedSize2, generationSize3, totalPromotedSize3,
+                 generationSize4, totalPromotedSize4, finalizationPromotedSize, finalizationPromotedCount,
+                 pinnedObjectCount, sinkBlockCount, gcHandleCount);
+
     // TODO: FireEtwGCHeapStats_V2
     FireEtwGCHeapStats_V1(generationSize0, totalPromotedSize0, generationSize1, totalPromotedSize1,
                           generationSize2, totalPromotedSize2, generationSize3, totalPromotedSize3,
@@ -81,6 +94,8 @@ void GCToCLREventSink::FireGCCreateSegment_V1(void* address, size_t size, uint32
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCCreateSegment_V1, address, static_cast<uint64_t>(size), type);
+
     FireEtwGCCreateSegment_V1((uint64_t)address, static_cast<uint64_t>(size), type, GetClrInstanceId());
 }
 
@@ -88,6 +103,8 @@ void GCToCLREventSink::FireGCFreeSegment_V1(void* address)
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCFreeSegment_V1, address);
+
     FireEtwGCFreeSegment_V1((uint64_t)address, GetClrInstanceId());
 }
 
@@ -95,6 +112,8 @@ void GCToCLREventSink::FireGCCreateConcurrentThread_V1()
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCCreateConcurrentThread_V1);
+
     FireEtwGCCreateConcurrentThread_V1(GetClrInstanceId());
 }
 
@@ -102,6 +121,8 @@ void GCToCLREventSink::FireGCTerminateConcurrentThread_V1()
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCTerminateConcurrentThread_V1);
+
     FireEtwGCTerminateConcurrentThread_V1(GetClrInstanceId());
 }
 
@@ -109,6 +130,8 @@ void GCToCLREventSink::FireGCTriggered(uint32_t reason)
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCTriggered, reason);
+
     FireEtwGCTriggered(reason, GetClrInstanceId());
 }
 
@@ -116,6 +139,8 @@ void GCToCLREventSink::FireGCMarkWithType(uint32_t heapNum, uint32_t type, uint6
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCMarkWithType, heapNum, type, bytes);
+
     FireEtwGCMarkWithType(heapNum, GetClrInstanceId(), type, bytes);
 }
 
@@ -123,6 +148,8 @@ void GCToCLREventSink::FireGCJoin_V2(uint32_t heap, uint32_t joinTime, uint32_t
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCJoin_V2, heap, joinTime, joinType, joinId);
+
     FireEtwGCJoin_V2(heap, joinTime, joinType, GetClrInstanceId(), joinId);
 }
 
@@ -139,6 +166,10 @@ void GCToCLREventSink::FireGCGlobalHeapHistory_V3(uint64_t finalYoungestDesired,
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCGlobalHeapHistory_V3,
+                 finalYoungestDesired, numHeaps, condemnedGeneration, gen0reductionCount, reason,
+                 globalMechanisms, pauseMode, memoryPressure, condemnReasons0, condemnReasons1);
+
     // TODO: FireEtwGCGlobalHeapHistory_V3
     FireEtwGCGlobalHeapHistory_V2(finalYoungestDesired, numHeaps, condemnedGeneration, gen0reductionCount, reason,
         globalMechanisms, GetClrInstanceId(), pauseMode, memoryPressure);
@@ -148,14 +179,52 @@ void GCToCLREventSink::FireGCAllocationTick_V1(uint32_t allocationAmount, uint32
 {
     LIMITED_METHOD_CONTRACT;
 
+    BINARY_EVENT(GCAllocationTick_V1, allocationAmount, allocationKind);
+
     FireEtwGCAllocationTick_V1(allocationAmount, allocationKind, GetClrInstanceId());
 }
 
+#ifdef FEATURE_BINARY_EVENT_SINK
+// Types the current thread has written a TypeInfo event for, indexed by a hash of the EEType address. A type
+// that got evicted just gets another TypeInfo event, so this stays small and needs no synchronization.
+#define ALLOCATION_TICK_TYPE_CACHE_SIZE 64
+static DECLSPEC_THREAD EEType * t_allocationTickTypes[ALLOCATION_TICK_TYPE_CACHE_SIZE];
+
+static void WriteAllocationTickTypeInfo(EEType * pEEType)
+{
+    EEType ** ppCachedType = &t_allocationTickTypes[((size_t)pEEType >> 3) % ALLOCATION_TICK_TYPE_CACHE_SIZE];
+    if (*ppCachedType == pEEType)
+        return;
+
+    *ppCachedType = pEEType;
+
+    void * pModuleBase = PalGetModuleHandleFromPointer(pEEType);
+    const TCHAR * pModuleName = nullptr;
+    Int32 moduleNameLength = (pModuleBase != nullptr) ? PalGetModuleFileName(&pModuleName, pModuleBase) : 0;
+    if (pModuleName == nullptr || moduleNameLength < 0)
+        moduleNameLength = 0;
+
+    BinaryEventBlob moduleName = { pModuleName, (uint32_t)(moduleNameLength * sizeof(TCHAR)) };
+    BINARY_EVENT(TypeInfo, pEEType, pModuleBase, (uint32_t)pEEType->get_BaseSize(), (uint32_t)pEEType->get_ComponentSize(), moduleName);
+}
+#endif // FEATURE_BINARY_EVENT_SINK
+
 void GCToCLREventSink::FireGCAllocationTick_V3(uint64_t allocationAmount, uint32_t allocationKind, uint32_t heapIndex, void* objectAddress)
 {
     LIMITED_METHOD_CONTRACT;
 
+    // The GC fires this on the allocating thread, so the thread's last allocated type is the one of the object.
     void * typeId = RedhawkGCInterface::GetLastAllocEEType();
+
+#ifdef FEATURE_BINARY_EVENT_SINK
+    if (BinaryEventSink::IsEnabled() && typeId != nullptr)
+    {
+        WriteAllocationTickTypeInfo(static_cast<EEType *>(typeId));
+    }
+#endif // FEATURE_BINARY_EVENT_SINK
+
+    BINARY_EVENT(GCAllocationTick_V3, allocationAmount, allocationKind, heapIndex, objectAddress, typeId);
+
     const WCHAR * name = nullptr;
 
     if (typeId != nullptr)
@@ -173,12 +242,12 @@ void GCToCLREventSink::FireGCAllocationTick_V3(uint64_t allocationAmount, uint32
 
 void GCToCLREventSink::FirePinObjectAtGCTime(void* object, uint8_t** ppObject)
 {
-    UNREFERENCED_PARAMETER(object);
-    UNREFERENCED_PARAMETER(ppObject);
+    BINARY_EVENT(PinObjectAtGCTime, object, ppObject);
 }
 
 void GCToCLREventSink::FirePinPlugAtGCTime(uint8_t* plugStart, uint8_t* plugEnd, uint8_t* gapBeforeSize)
 {
+    BINARY_EVENT(PinPlugAtGCTime, plugStart, plugEnd, gapBeforeSize);
     FireEtwPinPlugAtGCTime(plugStart, plugEnd, gapBeforeSize, GetClrInstanceId());
 }
 
@@ -199,6 +268,12 @@ void GCToCLREventSink::FireGCPerHeapHistory_V3(void *freeListAllocated,
                                                uint32_t valuesLen,
                                                void *values)
 {    
+    BINARY_EVENT(GCPerHeapHistory_V3,
+                 freeListAllocated, freeListRejected, endOfSegAllocated, condemnedAllocated,
+                 pinnedAllocated, pinnedAllocatedAdvance, runningFreeListEfficiency, condemnReasons0,
+                 condemnReasons1, compactMechanisms, expandMechanisms, heapIndex, extraGen0Commit, count,
+                 valuesLen, BinaryEventBlob{ values, count * valuesLen });
+
     FireEtwGCPerHeapHistory_V3(GetClrInstanceId(),
                                freeListAllocated,
                                freeListRejected,
@@ -222,91 +297,109 @@ void GCToCLREventSink::FireGCPerHeapHistory_V3(void *freeListAllocated,
 
 void GCToCLREventSink::FireBGCBegin()
 {
+    BINARY_EVENT(BGCBegin);
     FireEtwBGCBegin(GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGC1stNonConEnd()
 {
+    BINARY_EVENT(BGC1stNonConEnd);
     FireEtwBGC1stNonConEnd(GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGC1stConEnd()
 {
+    BINARY_EVENT(BGC1stConEnd);
     FireEtwBGC1stConEnd(GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGC1stSweepEnd(uint32_t genNumber)
 {
+    BINARY_EVENT(BGC1stSweepEnd, genNumber);
     //FireEtwBGC1stSweepEnd(genNumber, GetClrInstanceId()); TODO
 }
 
 void GCToCLREventSink::FireBGC2ndNonConBegin()
 {
+    BINARY_EVENT(BGC2ndNonConBegin);
     FireEtwBGC2ndNonConBegin(GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGC2ndNonConEnd()
 {
+    BINARY_EVENT(BGC2ndNonConEnd);
     FireEtwBGC2ndNonConEnd(GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGC2ndConBegin()
 {
+    BINARY_EVENT(BGC2ndConBegin);
     FireEtwBGC2ndConBegin(GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGC2ndConEnd()
 {
+    BINARY_EVENT(BGC2ndConEnd);
     FireEtwBGC2ndConEnd(GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGCDrainMark(uint64_t objects)
 {
+    BINARY_EVENT(BGCDrainMark, objects);
     FireEtwBGCDrainMark(objects, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGCRevisit(uint64_t pages, uint64_t objects, uint32_t isLarge)
 {
+    BINARY_EVENT(BGCRevisit, pages, objects, isLarge);
     FireEtwBGCRevisit(pages, objects, isLarge, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGCOverflow_V1(uint64_t min, uint64_t max, uint64_t objects, uint32_t isLarge, uint32_t genNumber)
 {
+    BINARY_EVENT(BGCOverflow_V1, min, max, objects, isLarge, genNumber);
     // TODO: FireBGCOverflow_V1
     FireEtwBGCOverflow(min, max, objects, isLarge, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGCAllocWaitBegin(uint32_t reason)
 {
+    BINARY_EVENT(BGCAllocWaitBegin, reason);
     FireEtwBGCAllocWaitBegin(reason, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireBGCAllocWaitEnd(uint32_t reason)
 {
+    BINARY_EVENT(BGCAllocWaitEnd, reason);
     FireEtwBGCAllocWaitEnd(reason, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireGCFullNotify_V1(uint32_t genNumber, uint32_t isAlloc)
 {
+    BINARY_EVENT(GCFullNotify_V1, genNumber, isAlloc);
     FireEtwGCFullNotify_V1(genNumber, isAlloc, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireSetGCHandle(void* handleID, void* objectID, uint32_t kind, uint32_t generation)
 {
+    BINARY_EVENT(SetGCHandle, handleID, objectID, kind, generation);
     FireEtwSetGCHandle(handleID, objectID, kind, generation, -1, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FirePrvSetGCHandle(void* handleID, void* objectID, uint32_t kind, uint32_t generation)
 {
+    BINARY_EVENT(PrvSetGCHandle, handleID, objectID, kind, generation);
     FireEtwPrvSetGCHandle(handleID, objectID, kind, generation, -1, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FireDestroyGCHandle(void *handleID)
 {
+    BINARY_EVENT(DestroyGCHandle, handleID);
     FireEtwDestroyGCHandle(handleID, GetClrInstanceId());
 }
 
 void GCToCLREventSink::FirePrvDestroyGCHandle(void *handleID)
 {
+    BINARY_EVENT(PrvDestroyGCHandle, handleID);
     FireEtwPrvDestroyGCHandle(handleID, GetClrInstanceId());
 }
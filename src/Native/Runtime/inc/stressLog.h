@@ -42,6 +42,8 @@
 
 #if defined(STRESS_LOG)
 
+#include "stressLogFile.h"
+
 //
 // Logging levels and facilities
 //
@@ -292,16 +294,17 @@ public:
     Int32 totalChunk;                       // current number of total chunks allocated
     PTR_ThreadStressLog logs;               // the list of logs for every thread.
     Int32 deadCount;                        // count of dead threads in the log
-    CrstStatic *pLock;                      // lock
+    PTR_ThreadStressLog deadLogs;           // logs of dead threads that can be reused
     unsigned __int64 tickFrequency;         // number of ticks per second
     unsigned __int64 startTimeStamp;        // start time from when tick counter started
     FILETIME startTime;                     // time the application started
     size_t   moduleOffset;                  // Used to compute format strings.
+    StressLogFileHeader* pFileHeader;       // the mapped file backing the log, NULL if the log is in memory
 
 #ifndef DACCESS_COMPILE
 public:
     static void Initialize(unsigned facilities, unsigned level, unsigned maxBytesPerThread, 
-                    unsigned maxBytesTotal, HANDLE hMod);
+                    unsigned maxBytesTotal, HANDLE hMod, bool backWithFile = false);
     // Called at DllMain THREAD_DETACH to recycle thread's logs
     static void ThreadDetach(ThreadStressLog *msgs);
     static long NewChunk ()     { return PalInterlockedIncrement (&theLog.totalChunk); }
@@ -320,6 +323,13 @@ public:
 // private:
     static ThreadStressLog* CreateThreadStressLog(Thread * pThread);
     static ThreadStressLog* CreateThreadStressLogHelper(Thread * pThread);
+    static ThreadStressLog* TakeDeadThreadStressLog();
+
+#ifdef FEATURE_STRESS_LOG_FILE
+    // Creates and maps the file backing the log, with room for maxBytesTotal / maxBytesPerThread threads.
+    // Returns NULL if the file could not be created, in which case the log stays in memory.
+    static StressLogFileHeader* CreateLogFile(unsigned maxBytesPerThread, unsigned maxBytesTotal);
+#endif // FEATURE_STRESS_LOG_FILE
 
 #else // DACCESS_COMPILE
 public:
@@ -533,6 +543,7 @@ struct StressLogChunk
 //     to the corresponding field
 class ThreadStressLog {
     PTR_ThreadStressLog next;   // we keep a linked list of these
+    PTR_ThreadStressLog nextDead; // next log on StressLog::deadLogs
     uint64_t   threadId;        // the id for the thread using this buffer
     bool       isDead;          // Is this thread dead 
     bool       readHasWrapped;      // set when read ptr has passed chunListTail
@@ -546,6 +557,7 @@ class ThreadStressLog {
     long chunkListLength;       // how many stress log chunks are in this stress log
     PTR_Thread pThread;         // thread associated with these stress logs
     StressMsg * origCurPtr;     // this holds the original curPtr before we start the dump
+    StressLogFileSlot* pFileSlot; // the slot holding the chunks when the log is backed by a file
 
     friend class StressLog;
 
@@ -567,6 +579,10 @@ private:
     FORCEINLINE StressMsg* AdvanceWrite(int cArgs);
     inline StressMsg* AdvWritePastBoundary(int cArgs);
     FORCEINLINE bool GrowChunkList ();
+#ifdef FEATURE_STRESS_LOG_FILE
+    bool AttachFileSlot ();
+    void PublishWritePosition ();
+#endif // FEATURE_STRESS_LOG_FILE
 
 #else // DACCESS_COMPILE
 public:
@@ -686,34 +702,49 @@ inline StressMsg* ThreadStressLog::AdvReadPastBoundary() {
 inline ThreadStressLog::ThreadStressLog()
 {
     chunkListHead = chunkListTail = curWriteChunk = NULL;
-    StressLogChunk * newChunk = new (nothrow) StressLogChunk;        
-    //OOM or in cantalloc region
-    if (newChunk == NULL)
+    pFileSlot = NULL;
+#ifdef FEATURE_STRESS_LOG_FILE
+    if (StressLog::theLog.pFileHeader != NULL)
     {
-        return;
-    }     
-    StressLog::NewChunk ();
-
-    newChunk->prev = newChunk;
-    newChunk->next = newChunk;
-        
-    chunkListHead = chunkListTail = newChunk;
+        // the chunks are in a slot of the file, which has all the chunks this thread will ever get
+        if (!AttachFileSlot ())
+        {
+            return;
+        }
+    }
+    else
+#endif // FEATURE_STRESS_LOG_FILE
+    {
+        StressLogChunk * newChunk = new (nothrow) StressLogChunk;        
+        //OOM or in cantalloc region
+        if (newChunk == NULL)
+        {
+            return;
+        }     
+        StressLog::NewChunk ();
+
+        newChunk->prev = newChunk;
+        newChunk->next = newChunk;
+            
+        chunkListHead = chunkListTail = newChunk;
+        chunkListLength = 1;
+    }
 
     next = NULL;
+    nextDead = NULL;
     isDead = TRUE;
     curPtr = NULL;
     readPtr = NULL;
     writeHasWrapped = FALSE;
     curReadChunk = NULL;
     curWriteChunk = NULL;
-    chunkListLength = 1;
     origCurPtr = NULL;
 }
 
 inline ThreadStressLog::~ThreadStressLog ()
 {
-    //no thing to do if the list is empty (failed to initialize)
-    if (chunkListHead == NULL)
+    //no thing to do if the list is empty (failed to initialize) or the chunks belong to the file
+    if (chunkListHead == NULL || pFileSlot != NULL)
     {
         return;
     }
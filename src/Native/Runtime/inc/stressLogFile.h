@@ -0,0 +1,80 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+// ---------------------------------------------------------------------------
+// stressLogFile.h
+//
+// Layout of the file the stress log is written to when it is backed by a
+//   memory mapped file (see StressLog::CreateLogFile).
+//
+// The file starts with a StressLogFileHeader, followed by slotCount slots
+//   of slotSize bytes each. Every thread that logs owns one slot, which is
+//   a StressLogFileSlot followed by chunksPerSlot StressLogChunks. The
+//   chunks of a slot are used as one circular buffer: messages are written
+//   from the end of a chunk towards its start, and the writer then moves
+//   on to the next chunk in the file, wrapping around from the last chunk
+//   of the slot to the first one.
+//
+// Since the file is shared with the page cache, everything that was written
+//   before the process died is still in the file after a crash or SIGKILL.
+//
+// Messages store the offset of their format string from moduleBase. The
+//   format strings can be read back from the module file on disk using the
+//   segment table, which maps offsets from moduleBase to file offsets.
+//
+// src/Native/Runtime/unix/stresslogdump.py decodes these files.
+// ---------------------------------------------------------------------------
+
+#ifndef StressLogFile_h
+#define StressLogFile_h
+
+#define STRESSLOG_FILE_MAGIC            0x4C534852  // 'RHSL'
+#define STRESSLOG_FILE_VERSION          1
+#define STRESSLOG_FILE_MAX_SEGMENTS     16
+#define STRESSLOG_FILE_MAX_PATH         1024
+
+// Set in StressLogFileSlot::writePosition once the writer has gone around the slot at least once.
+#define STRESSLOG_FILE_WRAPPED          0x8000000000000000ull
+
+struct StressLogFileSegment
+{
+    uint64_t moduleOffset;      // offset of the segment from moduleBase
+    uint64_t fileOffset;        // offset of the segment in the module file
+    uint64_t size;              // number of bytes of the segment backed by the module file
+};
+
+struct StressLogFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t pointerSize;       // size of the message arguments
+    uint32_t chunkSize;         // size of the message buffer of a chunk
+    uint32_t chunkStride;       // size of a StressLogChunk
+    uint32_t chunkBufOffset;    // offset of the message buffer within a StressLogChunk
+    uint32_t chunksPerSlot;
+    uint32_t slotCount;
+    uint32_t slotsUsed;         // number of slots handed out to threads so far
+    uint32_t slotHeaderSize;    // offset of the first chunk within a slot
+    uint64_t slotSize;
+    uint64_t headerSize;        // offset of the first slot within the file
+    uint64_t tickFrequency;     // number of timestamp ticks per second
+    uint64_t startTimeStamp;    // timestamp when the log was created
+    uint64_t startTime;         // FILETIME when the log was created
+    uint64_t moduleBase;        // address the format string offsets are relative to
+    uint32_t segmentCount;
+    uint32_t reserved;
+    StressLogFileSegment segments[STRESSLOG_FILE_MAX_SEGMENTS];
+    char modulePath[STRESSLOG_FILE_MAX_PATH];
+};
+
+struct StressLogFileSlot
+{
+    uint64_t threadId;
+    // Position of the most recently written message: the chunk index in bits 32-62, the offset of the
+    // message from the start of the chunk's message buffer in bits 0-31, and STRESSLOG_FILE_WRAPPED.
+    // Updated after each message is complete, so it never points at a partially written message.
+    uint64_t writePosition;
+    uint32_t isDead;
+    uint32_t reserved[3];
+};
+
+#endif // StressLogFile_h
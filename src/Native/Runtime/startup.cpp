@@ -26,6 +26,9 @@
 #include "stressLog.h"
 #include "RestrictedCallouts.h"
 #include "yieldprocessornormalized.h"
+#include "BinaryEventSink.h"
+#include "RuntimeCounters.h"
+#include "ExceptionProfiling.h"
 
 #ifndef DACCESS_COMPILE
 
@@ -93,6 +96,19 @@ static bool InitDLL(HANDLE hPalInstance)
 
     STARTUP_TIMELINE_EVENT(NONGC_INIT_COMPLETE);
 
+#ifdef FEATURE_BINARY_EVENT_SINK
+    BinaryEventSink::Initialize(g_pRhConfig->GetEventSinkKeywords(),
+                                g_pRhConfig->GetEventSinkLevel(),
+                                g_pRhConfig->GetEventSinkBufferSizeKB());
+#endif // FEATURE_BINARY_EVENT_SINK
+
+#ifdef FEATURE_RUNTIME_COUNTERS
+    RuntimeCounters::Initialize(g_pRhConfig->GetRuntimeCounters() != 0);
+#endif // FEATURE_RUNTIME_COUNTERS
+
+    ExceptionProfiling::Initialize(g_pRhConfig->GetExceptionProfiling() != 0,
+                                   g_pRhConfig->GetExceptionProfilingSampleRate());
+
     if (!RedhawkGCInterface::InitializeSubsystems())
         return false;
 
@@ -108,7 +124,8 @@ static bool InitDLL(HANDLE hPalInstance)
     {
         StressLog::Initialize(facility, dwStressLogLevel, 
                               dwPerThreadChunks * STRESSLOG_CHUNK_SIZE, 
-                              (unsigned)dwTotalStressLogSize, hPalInstance);
+                              (unsigned)dwTotalStressLogSize, hPalInstance,
+                              g_pRhConfig->GetStressLogToFile() != 0);
     }
 #endif // STRESS_LOG
 
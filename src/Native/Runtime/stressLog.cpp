@@ -91,7 +91,7 @@ const static unsigned __int64 RECYCLE_AGE = 0x40000000L;        // after a billi
 #ifndef DACCESS_COMPILE
 
 void StressLog::Initialize(unsigned facilities,  unsigned level, unsigned maxBytesPerThread, 
-            unsigned maxBytesTotal, HANDLE hMod) 
+            unsigned maxBytesTotal, HANDLE hMod, bool backWithFile) 
 {
     if (theLog.MaxSizePerThread != 0)
     {
@@ -101,8 +101,6 @@ void StressLog::Initialize(unsigned facilities,  unsigned level, unsigned maxByt
 
     g_pStressLog = &theLog;
 
-    theLog.pLock = new (nothrow) CrstStatic();
-    theLog.pLock->Init(CrstStressLog);
     if (maxBytesPerThread < STRESSLOG_CHUNK_SIZE)
     {
         maxBytesPerThread = STRESSLOG_CHUNK_SIZE;
@@ -118,6 +116,7 @@ void StressLog::Initialize(unsigned facilities,  unsigned level, unsigned maxByt
     theLog.facilitiesToLog = facilities | LF_ALWAYS;
     theLog.levelToLog = level;
     theLog.deadCount = 0;
+    theLog.deadLogs = NULL;
     
     theLog.tickFrequency = getTickFrequency();
     
@@ -125,6 +124,15 @@ void StressLog::Initialize(unsigned facilities,  unsigned level, unsigned maxByt
     theLog.startTimeStamp = getTimeStamp();
 
     theLog.moduleOffset = (size_t)hMod; // HMODULES are base addresses.
+
+#ifdef FEATURE_STRESS_LOG_FILE
+    if (backWithFile)
+    {
+        theLog.pFileHeader = CreateLogFile(maxBytesPerThread, maxBytesTotal);
+    }
+#else // FEATURE_STRESS_LOG_FILE
+    UNREFERENCED_PARAMETER(backWithFile);
+#endif // FEATURE_STRESS_LOG_FILE
 }
 
 /*********************************************************************************/
@@ -150,92 +158,135 @@ ThreadStressLog* StressLog::CreateThreadStressLog(Thread * pThread) {
         return NULL;
     }
 
-    CrstHolder holder(theLog.pLock);
-
     msgs = CreateThreadStressLogHelper(pThread);
 
+    // cache the log on the thread so that it is only looked for once
+    if (msgs != NULL)
+    {
+        pThread->SetThreadStressLog(msgs);
+    }
+
     return msgs;
 }
 
+/*********************************************************************************/
+/* Thread logs are never freed, dead threads put theirs (and its chunks) on the   */
+/* deadLogs list for new threads to reuse. Nothing here takes a lock, threads     */
+/* that come and go at a high rate would otherwise all serialize on it.          */
+/* The deadLogs list is only ever pushed to, or taken as a whole by exchanging    */
+/* it with NULL, so its updates are not subject to ABA problems.                 */
+
 ThreadStressLog* StressLog::CreateThreadStressLogHelper(Thread * pThread) {
 
-    bool skipInsert = FALSE;
     ThreadStressLog* msgs = NULL;
 
     // See if we can recycle a dead thread
     if (VolatileLoad(&theLog.deadCount) > 0) 
     {        
-        unsigned __int64 recycleStamp = getTimeStamp() - RECYCLE_AGE;
-        msgs = VolatileLoad(&theLog.logs);
-        //find out oldest dead ThreadStressLog in case we can't find one within 
-        //recycle age but can't create a new chunk
-        ThreadStressLog * oldestDeadMsg = NULL;
-        
-        while(msgs != 0) 
+        msgs = TakeDeadThreadStressLog();
+        if (msgs != NULL)
         {
-            if (msgs->isDead)
-            {
-                bool hasTimeStamp = msgs->curPtr != (StressMsg *)msgs->chunkListTail->EndPtr();
-                if (hasTimeStamp && msgs->curPtr->timeStamp < recycleStamp) 
-                {
-                    skipInsert = TRUE;                
-                    PalInterlockedDecrement(&theLog.deadCount);
-                    break;
-                }
-                
-                if (!oldestDeadMsg)
-                {
-                    oldestDeadMsg = msgs;
-                }                
-                else if (hasTimeStamp && oldestDeadMsg->curPtr->timeStamp > msgs->curPtr->timeStamp)
-                {
-                    oldestDeadMsg = msgs;
-                }                               
-            }
-            
-            msgs = msgs->next;
+            msgs->Activate (pThread);
+            return msgs;
         }
+    }
 
-        //if the total stress log size limit is already passed and we can't add new chunk,
-        //always reuse the oldest dead msg
-        if (!AllowNewChunk (0) && !msgs)
-        {
-            msgs = oldestDeadMsg;
-            skipInsert = TRUE;
-            PalInterlockedDecrement(&theLog.deadCount);
-        }
+    msgs = new (nothrow) ThreadStressLog();
+
+    if (msgs == 0 ||!msgs->IsValid ()) 
+    {
+        delete msgs;
+        return NULL;
     }
 
-    if (msgs == 0)  {
-        msgs = new (nothrow) ThreadStressLog();
+    msgs->Activate (pThread);
+
+    // Put it into the stress log
+    ThreadStressLog* head;
+    do
+    {
+        head = VolatileLoad(&theLog.logs);
+        msgs->next = head;
+    }
+    while (PalInterlockedCompareExchangePointer((void * volatile *)&theLog.logs, msgs, head) != head);
+
+    return msgs;
+}
+
+/*********************************************************************************/
+/* Take a dead thread log that can be reused off the deadLogs list, or NULL.     */
+
+ThreadStressLog* StressLog::TakeDeadThreadStressLog()
+{
+    ThreadStressLog* deadLogs = (ThreadStressLog*)PalInterlockedExchangePointer((void * volatile *)&theLog.deadLogs, NULL);
+    if (deadLogs == NULL)
+    {
+        return NULL;
+    }
+
+    unsigned __int64 recycleStamp = getTimeStamp() - RECYCLE_AGE;
 
-        if (msgs == 0 ||!msgs->IsValid ()) 
+    //find out oldest dead ThreadStressLog in case we can't find one within 
+    //recycle age but can't create a new chunk
+    ThreadStressLog ** ppOldestDeadMsg = NULL;
+    ThreadStressLog ** ppMsgs = &deadLogs;
+    ThreadStressLog ** ppTake = NULL;
+
+    for (; *ppMsgs != NULL; ppMsgs = &(*ppMsgs)->nextDead)
+    {
+        ThreadStressLog * msgs = *ppMsgs;
+        bool hasTimeStamp = msgs->curPtr != (StressMsg *)msgs->chunkListTail->EndPtr();
+        if (hasTimeStamp && msgs->curPtr->timeStamp < recycleStamp) 
         {
-            delete msgs;
-            msgs = 0;
-            goto LEAVE;
+            ppTake = ppMsgs;
+            break;
         }
+
+        if (!ppOldestDeadMsg)
+        {
+            ppOldestDeadMsg = ppMsgs;
+        }                
+        else if (hasTimeStamp && (*ppOldestDeadMsg)->curPtr->timeStamp > msgs->curPtr->timeStamp)
+        {
+            ppOldestDeadMsg = ppMsgs;
+        }                               
     }
 
-    msgs->Activate (pThread);
+    //if the total stress log size limit is already passed and we can't add new chunk,
+    //always reuse the oldest dead msg
+    if (ppTake == NULL && !AllowNewChunk (0))
+    {
+        ppTake = ppOldestDeadMsg;
+    }
 
-    if (!skipInsert) {
-#ifdef _DEBUG
-        ThreadStressLog* walk = VolatileLoad(&theLog.logs);
-        while (walk)
+    ThreadStressLog * taken = NULL;
+    if (ppTake != NULL)
+    {
+        taken = *ppTake;
+        *ppTake = taken->nextDead;
+        taken->nextDead = NULL;
+        PalInterlockedDecrement(&theLog.deadCount);
+    }
+
+    // Put the rest back, in front of anything that died in the meantime
+    if (deadLogs != NULL)
+    {
+        ThreadStressLog * last = deadLogs;
+        while (last->nextDead != NULL)
         {
-            _ASSERTE (walk != msgs);
-            walk = walk->next;
+            last = last->nextDead;
         }
-#endif
-        // Put it into the stress log
-        msgs->next = VolatileLoad(&theLog.logs);
-        VolatileStore(&theLog.logs, msgs);
+
+        ThreadStressLog* head;
+        do
+        {
+            head = VolatileLoad(&theLog.deadLogs);
+            last->nextDead = head;
+        }
+        while (PalInterlockedCompareExchangePointer((void * volatile *)&theLog.deadLogs, deadLogs, head) != head);
     }
 
-LEAVE:
-    ;
-    return msgs;
+    return taken;
 }
 
 /*********************************************************************************/
@@ -251,11 +302,33 @@ void StressLog::ThreadDetach(ThreadStressLog *msgs) {
     msgs->LogMsg (LF_STARTUP, 0, "******* DllMain THREAD_DETACH called Thread dying *******\n");
 
     msgs->isDead = TRUE;
+    if (msgs->pFileSlot != NULL)
+    {
+        msgs->pFileSlot->isDead = 1;
+    }
+
+    // counted before it is on the list, so that a log on the list is always counted
     PalInterlockedIncrement(&theLog.deadCount);
+
+    ThreadStressLog* head;
+    do
+    {
+        head = VolatileLoad(&theLog.deadLogs);
+        msgs->nextDead = head;
+    }
+    while (PalInterlockedCompareExchangePointer((void * volatile *)&theLog.deadLogs, msgs, head) != head);
 }
 
 bool StressLog::AllowNewChunk (long numChunksInCurThread)
 {
+#ifdef FEATURE_STRESS_LOG_FILE
+    if (theLog.pFileHeader != NULL)
+    {
+        // a file backed log never grows, a thread can only get a new log while the file has unused slots
+        return numChunksInCurThread == 0 && VolatileLoad(&theLog.pFileHeader->slotsUsed) < theLog.pFileHeader->slotCount;
+    }
+#endif // FEATURE_STRESS_LOG_FILE
+
     _ASSERTE (numChunksInCurThread <= VolatileLoad(&theLog.totalChunk));
     UInt32 perThreadLimit = theLog.MaxSizePerThread;
 
@@ -340,9 +413,71 @@ void ThreadStressLog::LogMsg ( UInt32 facility, int cArgs, const char* format, v
         msg->args[i] = data;
     }
 
+#ifdef FEATURE_STRESS_LOG_FILE
+    if (pFileSlot != NULL)
+    {
+        PublishWritePosition();
+    }
+#endif // FEATURE_STRESS_LOG_FILE
+
     ASSERT(IsValid() && threadId == PalGetCurrentThreadIdForLogging());
 }
 
+#ifdef FEATURE_STRESS_LOG_FILE
+
+/*********************************************************************************/
+/* Take the next unused slot of the file and link its chunks into a circular list.
+   The writer follows the prev links, so they go to the next chunk in the file,
+   which lets a reader of the file walk the log without any of the pointers.    */
+
+bool ThreadStressLog::AttachFileSlot ()
+{
+    StressLogFileHeader* pHeader = StressLog::theLog.pFileHeader;
+    UInt32 slotIndex;
+    do
+    {
+        slotIndex = VolatileLoad(&pHeader->slotsUsed);
+        if (slotIndex >= pHeader->slotCount)
+        {
+            return FALSE;
+        }
+    }
+    while ((UInt32)PalInterlockedCompareExchange((Int32 volatile *)&pHeader->slotsUsed, (Int32)(slotIndex + 1), (Int32)slotIndex) != slotIndex);
+
+    UInt8* pSlotStart = (UInt8*)pHeader + pHeader->headerSize + slotIndex * pHeader->slotSize;
+    StressLogFileSlot* pSlot = (StressLogFileSlot*)pSlotStart;
+    StressLogChunk* chunks = (StressLogChunk*)(pSlotStart + pHeader->slotHeaderSize);
+    long chunkCount = (long)pHeader->chunksPerSlot;
+
+    for (long i = 0; i < chunkCount; i++)
+    {
+        new (&chunks[i]) StressLogChunk (&chunks[(i + 1) % chunkCount], &chunks[(i + chunkCount - 1) % chunkCount]);
+    }
+
+    chunkListTail = &chunks[0];
+    chunkListHead = &chunks[chunkCount - 1];
+    chunkListLength = chunkCount;
+    pFileSlot = pSlot;
+    return TRUE;
+}
+
+/*********************************************************************************/
+/* Record where the most recent message is, so that it can be found in the file */
+
+void ThreadStressLog::PublishWritePosition ()
+{
+    UInt64 chunkIndex = (UInt64)(curWriteChunk - chunkListTail);
+    UInt64 offset = (UInt64)((char *)curPtr - curWriteChunk->StartPtr ());
+    UInt64 position = (chunkIndex << 32) | offset;
+    if (writeHasWrapped)
+    {
+        position |= STRESSLOG_FILE_WRAPPED;
+    }
+    VolatileStore(&pFileSlot->writePosition, position);
+}
+
+#endif // FEATURE_STRESS_LOG_FILE
+
 
 void ThreadStressLog::Activate (Thread * pThread)
 {
@@ -355,6 +490,15 @@ void ThreadStressLog::Activate (Thread * pThread)
     writeHasWrapped = FALSE;
     this->pThread = pThread;
     ASSERT(pThread->IsCurrentThread());
+
+#ifdef FEATURE_STRESS_LOG_FILE
+    if (pFileSlot != NULL)
+    {
+        pFileSlot->threadId = threadId;
+        pFileSlot->isDead = 0;
+        PublishWritePosition();
+    }
+#endif // FEATURE_STRESS_LOG_FILE
 }
 
 /* static */
@@ -28,6 +28,7 @@
 #include "GCMemoryHelpers.h"
 
 #include "Debug.h"
+#include "RuntimeCounters.h"
 #include "DebugEventSource.h"
 #include "DebugFuncEval.h"
 
@@ -143,6 +144,8 @@ void ThreadStore::AttachCurrentThread(bool fAcquireThreadStoreLock)
     pAttachingThread->m_ThreadStateFlags = Thread::TSF_Attached;
 
     pTS->m_ThreadList.PushHead(pAttachingThread);
+
+    RUNTIME_COUNTER_INC(threadCount);
 }
 
 // static 
@@ -178,6 +181,8 @@ void ThreadStore::DetachCurrentThread()
     ASSERT(rh::std::count(pTS->m_ThreadList.Begin(), pTS->m_ThreadList.End(), pDetachingThread) == 1);
     pTS->m_ThreadList.RemoveFirst(pDetachingThread);
     pDetachingThread->Destroy();
+
+    RUNTIME_COUNTER_DEC(threadCount);
 }
 
 // Used by GC to prevent new threads during a GC.  New threads must take a write lock to 
@@ -500,6 +505,7 @@ COOP_PINVOKE_HELPER(Boolean, RhGetExceptionsForCurrentThread, (Array* pOutputArr
 Boolean ThreadStore::GetExceptionsForCurrentThread(Array* pOutputArray, Int32* pWrittenCountOut)
 {
     Int32 countWritten = 0;
+    Object** pArrayStart;
     Object** pArrayElements;
     Thread * pThread = GetCurrentThread();
     
@@ -525,7 +531,8 @@ Boolean ThreadStore::GetExceptionsForCurrentThread(Array* pOutputArray, Int32* p
     if (countWritten == 0)
         return Boolean_true;
 
-    pArrayElements = (Object**)pOutputArray->GetArrayData();
+    pArrayStart = (Object**)pOutputArray->GetArrayData();
+    pArrayElements = pArrayStart;
     for (PTR_ExInfo pInfo = pThread->m_pExInfoStackHead; pInfo != NULL; pInfo = pInfo->m_pPrevExInfo)
     {
         if (pInfo->m_exception == NULL)
@@ -535,7 +542,7 @@ Boolean ThreadStore::GetExceptionsForCurrentThread(Array* pOutputArray, Int32* p
         pArrayElements++;
     }
 
-    RhpBulkWriteBarrier(pArrayElements, countWritten * POINTER_SIZE);
+    RhpBulkWriteBarrier(pArrayStart, countWritten * POINTER_SIZE);
     return Boolean_true;
 
 Error:
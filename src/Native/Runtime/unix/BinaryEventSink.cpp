@@ -0,0 +1,421 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Implementation of the binary event sink (see BinaryEventSink.h for the file format).
+//
+// Each CPU has its own ring buffer. Producers reserve space in the ring of the CPU they run on with a
+// compare-exchange of the ring's head, fill in the record and then publish it by storing the record size
+// with release semantics. A record that doesn't fit before the end of the buffer is preceded by a padding
+// record covering the rest of the buffer. When a ring is full the event is dropped and counted rather than
+// waiting for the drain thread, so firing an event never blocks.
+//
+// The drain thread wakes up periodically, copies the published records of each ring to the output file,
+// zeroes the consumed space (a zero size is what tells it a record has not been published yet) and then
+// releases the space to the producers by advancing the ring's tail.
+//
+
+#include "common.h"
+#include "gcenv.h"
+#include "gcheaputilities.h"
+#include "config.h"
+#include "RhConfig.h"
+#include "BinaryEventSink.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define BINARY_EVENT_SINK_MAGIC     0x56454852  // 'RHEV'
+#define BINARY_EVENT_SINK_VERSION   2
+
+// Event id of the padding records used to skip the end of a ring buffer. These never make it to the file.
+#define BINARY_EVENT_PADDING_ID     0xFFFF
+
+#define BINARY_EVENT_DEFAULT_BUFFER_SIZE_KB 256
+#define BINARY_EVENT_MAX_RINGS              256
+#define BINARY_EVENT_DRAIN_INTERVAL_MS      100
+
+struct BinaryEventRecordHeader
+{
+    uint32_t recordSize;
+    uint16_t eventId;
+    uint16_t cpu;
+    uint32_t threadId;
+    uint32_t payloadSize;
+    uint64_t timestamp;
+};
+
+static_assert(sizeof(BinaryEventRecordHeader) == 24, "The record header is part of the file format");
+
+struct BinaryEventRing
+{
+    uint8_t* buffer;
+    uint32_t size;
+
+    // Bytes reserved by producers so far. Kept on its own cache line since all the producers on the CPU
+    // update it.
+    alignas(64) uint64_t head;
+
+    // Bytes released by the drain thread so far.
+    alignas(64) uint64_t tail;
+
+    uint64_t lostEvents;
+    uint64_t reportedLostEvents;
+};
+
+struct BinaryEventName
+{
+    const char* name;
+    uint8_t provider;
+};
+
+static const BinaryEventName s_eventNames[] =
+{
+    { "EventsLost", 2 },
+
+#define KNOWN_EVENT(name, provider, level, keyword) { #name, provider },
+#include "gcevents.h"
+
+    { "SuspendEEBegin", 2 },
+    { "SuspendEEEnd", 2 },
+    { "RestartEEBegin", 2 },
+    { "RestartEEEnd", 2 },
+    { "TypeInfo", 2 },
+};
+
+static_assert(sizeof(s_eventNames) / sizeof(s_eventNames[0]) == BinaryEventId_Count, "Every event needs a name");
+
+bool BinaryEventSink::s_enabled = false;
+
+static BinaryEventRing* s_rings;
+static uint32_t s_ringCount;
+static FILE* s_outputFile;
+static pthread_mutex_t s_drainLock = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread uint32_t t_threadId;
+
+static uint64_t GetTimestamp()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static uint32_t GetThreadId()
+{
+    if (t_threadId == 0)
+    {
+        t_threadId = (uint32_t)PalGetCurrentThreadIdForLogging();
+    }
+
+    return t_threadId;
+}
+
+static uint32_t GetCurrentCpu()
+{
+#if HAVE_SCHED_GETCPU
+    int cpu = sched_getcpu();
+    if (cpu >= 0)
+    {
+        return (uint32_t)cpu;
+    }
+#endif // HAVE_SCHED_GETCPU
+
+    // Without the current CPU, spreading the threads over the rings keeps the contention on each ring low.
+    return GetThreadId();
+}
+
+uint8_t* BinaryEventSink::BeginEvent(BinaryEventId eventId, uint32_t payloadSize)
+{
+    uint32_t cpu = GetCurrentCpu();
+    BinaryEventRing* pRing = &s_rings[cpu % s_ringCount];
+
+    uint32_t recordSize = (uint32_t)ALIGN_UP(sizeof(BinaryEventRecordHeader) + payloadSize, 8);
+    if (recordSize > pRing->size / 2)
+    {
+        __atomic_fetch_add(&pRing->lostEvents, 1, __ATOMIC_RELAXED);
+        return nullptr;
+    }
+
+    uint64_t head = __atomic_load_n(&pRing->head, __ATOMIC_RELAXED);
+    uint32_t offset;
+    uint32_t padding;
+    while (true)
+    {
+        offset = (uint32_t)head & (pRing->size - 1);
+        padding = (offset + recordSize > pRing->size) ? pRing->size - offset : 0;
+
+        // The acquire pairs with the release in DrainRing so that the space is seen zeroed.
+        uint64_t tail = __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE);
+        if (head + padding + recordSize - tail > pRing->size)
+        {
+            __atomic_fetch_add(&pRing->lostEvents, 1, __ATOMIC_RELAXED);
+            return nullptr;
+        }
+
+        if (__atomic_compare_exchange_n(&pRing->head, &head, head + padding + recordSize, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        {
+            break;
+        }
+    }
+
+    if (padding != 0)
+    {
+        BinaryEventRecordHeader* pPadding = (BinaryEventRecordHeader*)(pRing->buffer + offset);
+        pPadding->eventId = BINARY_EVENT_PADDING_ID;
+        __atomic_store_n(&pPadding->recordSize, padding, __ATOMIC_RELEASE);
+        offset = 0;
+    }
+
+    BinaryEventRecordHeader* pHeader = (BinaryEventRecordHeader*)(pRing->buffer + offset);
+    pHeader->eventId = eventId;
+    pHeader->cpu = (uint16_t)cpu;
+    pHeader->threadId = GetThreadId();
+    pHeader->payloadSize = payloadSize;
+    pHeader->timestamp = GetTimestamp();
+
+    return (uint8_t*)(pHeader + 1);
+}
+
+void BinaryEventSink::EndEvent(uint8_t* pPayload)
+{
+    BinaryEventRecordHeader* pHeader = (BinaryEventRecordHeader*)pPayload - 1;
+    uint32_t recordSize = (uint32_t)ALIGN_UP(sizeof(BinaryEventRecordHeader) + pHeader->payloadSize, 8);
+
+    // Clear the alignment padding so that the file contents don't depend on stale buffer contents.
+    memset(pPayload + pHeader->payloadSize, 0, recordSize - sizeof(BinaryEventRecordHeader) - pHeader->payloadSize);
+
+    __atomic_store_n(&pHeader->recordSize, recordSize, __ATOMIC_RELEASE);
+}
+
+static void WriteEventsLost(uint32_t cpu, uint64_t count)
+{
+    struct
+    {
+        BinaryEventRecordHeader header;
+        uint64_t count;
+    } record;
+
+    record.header.recordSize = sizeof(record);
+    record.header.eventId = BinaryEventId_EventsLost;
+    record.header.cpu = (uint16_t)cpu;
+    record.header.threadId = GetThreadId();
+    record.header.payloadSize = sizeof(record.count);
+    record.header.timestamp = GetTimestamp();
+    record.count = count;
+
+    fwrite(&record, sizeof(record), 1, s_outputFile);
+}
+
+// Must be called with s_drainLock held.
+static void DrainRing(BinaryEventRing* pRing, uint32_t cpu)
+{
+    uint64_t start = pRing->tail;
+    uint64_t tail = start;
+
+    // The producers can't get further than a whole buffer ahead of the tail, so stop there even if more
+    // records get published while draining.
+    while (tail - start < pRing->size)
+    {
+        uint32_t offset = (uint32_t)tail & (pRing->size - 1);
+        BinaryEventRecordHeader* pHeader = (BinaryEventRecordHeader*)(pRing->buffer + offset);
+
+        // The acquire pairs with the release in EndEvent so that the whole record is seen.
+        uint32_t recordSize = __atomic_load_n(&pHeader->recordSize, __ATOMIC_ACQUIRE);
+        if (recordSize == 0)
+        {
+            break;
+        }
+
+        if (pHeader->eventId != BINARY_EVENT_PADDING_ID)
+        {
+            fwrite(pHeader, recordSize, 1, s_outputFile);
+        }
+
+        tail += recordSize;
+    }
+
+    if (tail != start)
+    {
+        uint32_t startOffset = (uint32_t)start & (pRing->size - 1);
+        uint32_t length = (uint32_t)(tail - start);
+        if (startOffset + length > pRing->size)
+        {
+            memset(pRing->buffer + startOffset, 0, pRing->size - startOffset);
+            memset(pRing->buffer, 0, startOffset + length - pRing->size);
+        }
+        else
+        {
+            memset(pRing->buffer + startOffset, 0, length);
+        }
+
+        __atomic_store_n(&pRing->tail, tail, __ATOMIC_RELEASE);
+    }
+
+    uint64_t lostEvents = __atomic_load_n(&pRing->lostEvents, __ATOMIC_RELAXED);
+    if (lostEvents != pRing->reportedLostEvents)
+    {
+        WriteEventsLost(cpu, lostEvents - pRing->reportedLostEvents);
+        pRing->reportedLostEvents = lostEvents;
+    }
+}
+
+static void DrainAllRings()
+{
+    pthread_mutex_lock(&s_drainLock);
+
+    for (uint32_t i = 0; i < s_ringCount; i++)
+    {
+        DrainRing(&s_rings[i], i);
+    }
+
+    fflush(s_outputFile);
+
+    pthread_mutex_unlock(&s_drainLock);
+}
+
+static UInt32 __stdcall DrainThreadProc(void*)
+{
+    while (true)
+    {
+        struct timespec interval = { 0, BINARY_EVENT_DRAIN_INTERVAL_MS * 1000000 };
+        nanosleep(&interval, nullptr);
+
+        DrainAllRings();
+    }
+
+    return 0;
+}
+
+static void FlushAtExit()
+{
+    DrainAllRings();
+}
+
+static bool WriteFileHeader()
+{
+    uint32_t header32[4] = { BINARY_EVENT_SINK_MAGIC, BINARY_EVENT_SINK_VERSION, sizeof(void*), BinaryEventId_Count };
+    uint64_t header64[3] = { 1000000000, GetTimestamp(), (uint64_t)getpid() };
+
+    if (fwrite(header32, sizeof(header32), 1, s_outputFile) != 1 ||
+        fwrite(header64, sizeof(header64), 1, s_outputFile) != 1)
+    {
+        return false;
+    }
+
+    for (uint16_t i = 0; i < BinaryEventId_Count; i++)
+    {
+        uint8_t nameLength = (uint8_t)strlen(s_eventNames[i].name);
+        if (fwrite(&i, sizeof(i), 1, s_outputFile) != 1 ||
+            fwrite(&s_eventNames[i].provider, sizeof(uint8_t), 1, s_outputFile) != 1 ||
+            fwrite(&nameLength, sizeof(nameLength), 1, s_outputFile) != 1 ||
+            fwrite(s_eventNames[i].name, nameLength, 1, s_outputFile) != 1)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Undoes a partially completed Initialize.
+static void ReleaseSink()
+{
+    if (s_rings != nullptr)
+    {
+        for (uint32_t i = 0; i < s_ringCount; i++)
+        {
+            free(s_rings[i].buffer);
+        }
+
+        free(s_rings);
+        s_rings = nullptr;
+    }
+
+    s_ringCount = 0;
+
+    if (s_outputFile != nullptr)
+    {
+        fclose(s_outputFile);
+        s_outputFile = nullptr;
+    }
+}
+
+void BinaryEventSink::Initialize(uint32_t keywords, uint32_t level, uint32_t bufferSizeKB)
+{
+    if (keywords == 0)
+    {
+        return;
+    }
+
+    // Failing to start the sink is not fatal, the process just runs without tracing.
+    TCHAR path[PATH_MAX];
+    if (g_pRhConfig->ReadConfigString(_T("RH_EventSinkFile"), path, PATH_MAX) == 0)
+    {
+        snprintf(path, sizeof(path), "rhevents.%d.bin", (int)getpid());
+    }
+
+    s_outputFile = fopen(path, "wb");
+    if (s_outputFile == nullptr)
+    {
+        return;
+    }
+
+    uint64_t bufferSize = (bufferSizeKB != 0 ? bufferSizeKB : BINARY_EVENT_DEFAULT_BUFFER_SIZE_KB) * (uint64_t)1024;
+    uint32_t ringSize = 4096;
+    while (ringSize < bufferSize && ringSize < 0x40000000)
+    {
+        ringSize *= 2;
+    }
+
+    long cpuCount = sysconf(_SC_NPROCESSORS_CONF);
+    s_ringCount = (cpuCount > BINARY_EVENT_MAX_RINGS) ? BINARY_EVENT_MAX_RINGS : (cpuCount > 0) ? (uint32_t)cpuCount : 1;
+
+    s_rings = (BinaryEventRing*)calloc(s_ringCount, sizeof(BinaryEventRing));
+    if (s_rings == nullptr)
+    {
+        ReleaseSink();
+        return;
+    }
+
+    for (uint32_t i = 0; i < s_ringCount; i++)
+    {
+        s_rings[i].buffer = (uint8_t*)calloc(ringSize, 1);
+        s_rings[i].size = ringSize;
+        if (s_rings[i].buffer == nullptr)
+        {
+            ReleaseSink();
+            return;
+        }
+    }
+
+    if (!WriteFileHeader())
+    {
+        ReleaseSink();
+        return;
+    }
+
+    if (!PalStartBackgroundGCThread(DrainThreadProc, nullptr))
+    {
+        ReleaseSink();
+        return;
+    }
+
+    atexit(FlushAtExit);
+
+    s_enabled = true;
+
+    // The GC checks these before firing any of its events, so this is what turns the events on. The same
+    // keywords are used for both GC providers: 0x1 turns on the public and private GC events, 0x4002 the
+    // handle events.
+    GCEventLevel eventLevel = (level > GCEventLevel_Verbose) ? GCEventLevel_Verbose : (GCEventLevel)level;
+    GCHeapUtilities::RecordEventStateChange(true, (GCEventKeyword)keywords, eventLevel);
+    GCHeapUtilities::RecordEventStateChange(false, (GCEventKeyword)keywords, eventLevel);
+}
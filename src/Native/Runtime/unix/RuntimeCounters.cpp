@@ -0,0 +1,79 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Creation of the shared memory file holding the runtime counters (see RuntimeCounters.h for the layout).
+//
+// The file is removed again when the process exits normally. A process that is killed leaves it behind,
+// but the process id in the block lets collectors tell stale files apart.
+//
+
+#include "common.h"
+#include "gcenv.h"
+#include "config.h"
+#include "RhConfig.h"
+#include "RuntimeCounters.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+RuntimeCountersBlock* RuntimeCounters::s_pBlock = nullptr;
+
+static char s_runtimeCountersPath[1024];
+
+static void RemoveRuntimeCountersFile()
+{
+    unlink(s_runtimeCountersPath);
+}
+
+void RuntimeCounters::Initialize(bool enabled)
+{
+    if (!enabled)
+    {
+        return;
+    }
+
+    if (g_pRhConfig->ReadConfigString(_T("RH_RuntimeCountersFile"), s_runtimeCountersPath, sizeof(s_runtimeCountersPath)) == 0)
+    {
+        snprintf(s_runtimeCountersPath, sizeof(s_runtimeCountersPath), "/dev/shm/rhcounters.%d", (int)getpid());
+    }
+
+    int fd = open(s_runtimeCountersPath, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        return;
+    }
+
+    size_t fileSize = ALIGN_UP(sizeof(RuntimeCountersBlock), (size_t)sysconf(_SC_PAGESIZE));
+
+    void* pFile = MAP_FAILED;
+    if (ftruncate(fd, (off_t)fileSize) == 0)
+    {
+        pFile = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    // The mapping keeps the file alive
+    close(fd);
+
+    if (pFile == MAP_FAILED)
+    {
+        unlink(s_runtimeCountersPath);
+        return;
+    }
+
+    RuntimeCountersBlock* pBlock = (RuntimeCountersBlock*)pFile;
+    pBlock->version = RUNTIME_COUNTERS_VERSION;
+    pBlock->size = sizeof(RuntimeCountersBlock);
+    pBlock->processId = (uint64_t)getpid();
+
+    // Written last so that a block with a valid magic is always initialized
+    __atomic_store_n(&pBlock->magic, RUNTIME_COUNTERS_MAGIC, __ATOMIC_RELEASE);
+
+    atexit(RemoveRuntimeCountersFile);
+
+    s_pBlock = pBlock;
+}
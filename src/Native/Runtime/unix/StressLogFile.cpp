@@ -0,0 +1,164 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+//
+// Creation of the memory mapped file backing the stress log (see stressLogFile.h for the file format).
+//
+// The file is mapped shared, so the messages written into it end up in the page cache and survive the
+// process being killed. Nothing is ever explicitly flushed, a message costs the same as with the in memory
+// log plus the store of the slot's write position.
+//
+
+#include "common.h"
+#include "CommonTypes.h"
+#include "CommonMacros.h"
+#include "CommonMacros.inl"
+#include "PalRedhawkCommon.h"
+#include "PalRedhawk.h"
+#include "daccess.h"
+#include "stressLog.h"
+#include "config.h"
+#include "RhConfig.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#if defined(STRESS_LOG) && defined(FEATURE_STRESS_LOG_FILE)
+
+struct ModuleSearchContext
+{
+    size_t moduleBase;
+    StressLogFileHeader* pHeader;
+};
+
+// Fills in the segment table and path of the module the format strings are in, which is the one with a
+// loadable segment containing the module base.
+static int FindFormatStringModule(struct dl_phdr_info* info, size_t /*size*/, void* data)
+{
+    ModuleSearchContext* pContext = (ModuleSearchContext*)data;
+
+    bool found = false;
+    for (int i = 0; i < info->dlpi_phnum; i++)
+    {
+        const ElfW(Phdr)* phdr = &info->dlpi_phdr[i];
+        if (phdr->p_type == PT_LOAD &&
+            info->dlpi_addr + phdr->p_vaddr <= pContext->moduleBase &&
+            pContext->moduleBase < info->dlpi_addr + phdr->p_vaddr + phdr->p_memsz)
+        {
+            found = true;
+            break;
+        }
+    }
+
+    if (!found)
+    {
+        return 0;
+    }
+
+    StressLogFileHeader* pHeader = pContext->pHeader;
+    for (int i = 0; i < info->dlpi_phnum && pHeader->segmentCount < STRESSLOG_FILE_MAX_SEGMENTS; i++)
+    {
+        const ElfW(Phdr)* phdr = &info->dlpi_phdr[i];
+        if (phdr->p_type != PT_LOAD)
+            continue;
+
+        StressLogFileSegment* pSegment = &pHeader->segments[pHeader->segmentCount++];
+        pSegment->moduleOffset = info->dlpi_addr + phdr->p_vaddr - pContext->moduleBase;
+        pSegment->fileOffset = phdr->p_offset;
+        pSegment->size = phdr->p_filesz;
+    }
+
+    // The main executable has no name in the list of loaded modules
+    if (info->dlpi_name != NULL && info->dlpi_name[0] != '\0')
+    {
+        strncpy(pHeader->modulePath, info->dlpi_name, STRESSLOG_FILE_MAX_PATH - 1);
+    }
+    else
+    {
+        ssize_t length = readlink("/proc/self/exe", pHeader->modulePath, STRESSLOG_FILE_MAX_PATH - 1);
+        pHeader->modulePath[length > 0 ? length : 0] = '\0';
+    }
+
+    return 1;
+}
+
+StressLogFileHeader* StressLog::CreateLogFile(unsigned maxBytesPerThread, unsigned maxBytesTotal)
+{
+    UInt32 chunksPerSlot = maxBytesPerThread / STRESSLOG_CHUNK_SIZE;
+    if (chunksPerSlot == 0)
+    {
+        chunksPerSlot = 1;
+    }
+
+    UInt32 slotCount = maxBytesTotal / (chunksPerSlot * STRESSLOG_CHUNK_SIZE);
+    if (slotCount == 0)
+    {
+        slotCount = 1;
+    }
+
+    UIntNative pageSize = (UIntNative)sysconf(_SC_PAGESIZE);
+    UIntNative headerSize = ALIGN_UP(sizeof(StressLogFileHeader), pageSize);
+    UIntNative slotHeaderSize = ALIGN_UP(sizeof(StressLogFileSlot), sizeof(void*));
+    UIntNative slotSize = ALIGN_UP(slotHeaderSize + chunksPerSlot * sizeof(StressLogChunk), sizeof(void*));
+    UIntNative fileSize = headerSize + slotCount * slotSize;
+
+    char path[PATH_MAX];
+    if (g_pRhConfig->ReadConfigString(_T("RH_StressLogFile"), path, PATH_MAX) == 0)
+    {
+        snprintf(path, sizeof(path), "rhstresslog.%d.bin", (int)getpid());
+    }
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1)
+    {
+        return NULL;
+    }
+
+    void* pFile = MAP_FAILED;
+    if (ftruncate(fd, (off_t)fileSize) == 0)
+    {
+        pFile = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+
+    // The mapping keeps the file alive
+    close(fd);
+
+    if (pFile == MAP_FAILED)
+    {
+        unlink(path);
+        return NULL;
+    }
+
+    StressLogFileHeader* pHeader = (StressLogFileHeader*)pFile;
+    pHeader->version = STRESSLOG_FILE_VERSION;
+    pHeader->pointerSize = sizeof(void*);
+    pHeader->chunkSize = STRESSLOG_CHUNK_SIZE;
+    pHeader->chunkStride = sizeof(StressLogChunk);
+    pHeader->chunkBufOffset = offsetof(StressLogChunk, buf);
+    pHeader->chunksPerSlot = chunksPerSlot;
+    pHeader->slotCount = slotCount;
+    pHeader->slotsUsed = 0;
+    pHeader->slotHeaderSize = (UInt32)slotHeaderSize;
+    pHeader->slotSize = slotSize;
+    pHeader->headerSize = headerSize;
+    pHeader->tickFrequency = theLog.tickFrequency;
+    pHeader->startTimeStamp = theLog.startTimeStamp;
+    pHeader->startTime = ((UInt64)theLog.startTime.dwHighDateTime << 32) | theLog.startTime.dwLowDateTime;
+    pHeader->moduleBase = theLog.moduleOffset;
+
+    ModuleSearchContext context = { theLog.moduleOffset, pHeader };
+    dl_iterate_phdr(FindFormatStringModule, &context);
+
+    // Written last so that a file with a valid magic is always complete
+    pHeader->magic = STRESSLOG_FILE_MAGIC;
+
+    return pHeader;
+}
+
+#endif // STRESS_LOG && FEATURE_STRESS_LOG_FILE
@@ -0,0 +1,222 @@
+#!/usr/bin/env python
+#
+## Licensed to the .NET Foundation under one or more agreements.
+## The .NET Foundation licenses this file to you under the MIT license.
+#
+##
+# Title               : stresslogdump.py
+#
+# Notes:
+#
+# Decodes the file a memory mapped stress log is written to (RH_StressLogToFile=1,
+# see src/Native/Runtime/inc/stressLogFile.h for the format). The format strings
+# are read from the module that logged them, so the module must be available at
+# the path recorded in the file or be given with --module.
+#
+# The messages of all threads are printed oldest first:
+#
+#   stresslogdump.py rhstresslog.1234.bin --seconds 5
+#
+################################################################################
+################################################################################
+
+import argparse
+import re
+import struct
+import sys
+
+STRESSLOG_FILE_MAGIC = 0x4C534852
+STRESSLOG_FILE_VERSION = 1
+STRESSLOG_FILE_MAX_SEGMENTS = 16
+STRESSLOG_FILE_MAX_PATH = 1024
+STRESSLOG_FILE_WRAPPED = 0x8000000000000000
+
+HEADER_FORMAT = '<10I6QII'
+SEGMENT_FORMAT = '<3Q'
+SLOT_FORMAT = '<QQI'
+
+MAX_ARG_COUNT = 7
+
+# %[flags][width][.precision][length]conversion, plus the %p extensions of the stress log
+FORMAT_SPEC = re.compile(r'%([-+ #0]*)(\d*)(?:\.(\d+))?(hh|h|ll|l|z|I64|I32|I)?([diouxXcsSp%])([TMK]?)')
+
+class LogFile:
+    def __init__(self, data):
+        self.data = data
+
+        fields = struct.unpack_from(HEADER_FORMAT, data, 0)
+        (self.magic, self.version, self.pointer_size, self.chunk_size, self.chunk_stride,
+         self.chunk_buf_offset, self.chunks_per_slot, self.slot_count, self.slots_used,
+         self.slot_header_size, self.slot_size, self.header_size, self.tick_frequency,
+         self.start_time_stamp, self.start_time, self.module_base, self.segment_count,
+         _) = fields
+
+        if self.magic != STRESSLOG_FILE_MAGIC:
+            raise ValueError('not a stress log file, or the process died before the log was created')
+        if self.version != STRESSLOG_FILE_VERSION:
+            raise ValueError('unsupported stress log file version %d' % self.version)
+
+        offset = struct.calcsize(HEADER_FORMAT)
+        self.segments = []
+        for i in range(STRESSLOG_FILE_MAX_SEGMENTS):
+            if i < self.segment_count:
+                self.segments.append(struct.unpack_from(SEGMENT_FORMAT, data, offset))
+            offset += struct.calcsize(SEGMENT_FORMAT)
+
+        path = data[offset:offset + STRESSLOG_FILE_MAX_PATH]
+        self.module_path = path[:path.index(b'\0')].decode('utf-8', 'replace') if b'\0' in path else ''
+
+        self.pointer_format = '<Q' if self.pointer_size == 8 else '<I'
+        self.max_message_size = 16 + MAX_ARG_COUNT * self.pointer_size
+
+    def chunk_buf(self, slot_start, chunk):
+        return slot_start + self.slot_header_size + chunk * self.chunk_stride + self.chunk_buf_offset
+
+    def read_message(self, address):
+        format_and_args, facility, time_stamp = struct.unpack_from('<IIQ', self.data, address)
+        arg_count = format_and_args & 0x7
+        format_offset = format_and_args >> 3
+        args = [struct.unpack_from(self.pointer_format, self.data, address + 16 + i * self.pointer_size)[0]
+                for i in range(arg_count)]
+        return format_offset, facility, time_stamp, args
+
+    def first_message_in_chunk(self, buf):
+        # The space before the first message of a chunk is zeroed
+        offset = 0
+        while offset < self.max_message_size and \
+              struct.unpack_from(self.pointer_format, self.data, buf + offset)[0] == 0:
+            offset += self.pointer_size
+        return 0 if offset >= self.max_message_size else offset
+
+    def thread_messages(self, slot):
+        """Yields (thread id, time stamp, facility, format offset, args) of the messages of a slot, newest first."""
+        slot_start = self.header_size + slot * self.slot_size
+        thread_id, write_position, _ = struct.unpack_from(SLOT_FORMAT, self.data, slot_start)
+
+        write_has_wrapped = (write_position & STRESSLOG_FILE_WRAPPED) != 0
+        write_chunk = (write_position >> 32) & 0x7FFFFFFF
+        write_offset = write_position & 0xFFFFFFFF
+        if write_chunk >= self.chunks_per_slot or write_offset > self.chunk_size:
+            return
+
+        # The message being written when the process died may have overwritten the oldest
+        # messages just before the write position, so stop reading a message short of it.
+        end_offset = max(write_offset - self.max_message_size, 0)
+
+        chunk = write_chunk
+        offset = write_offset
+        read_has_wrapped = False
+        while True:
+            if offset >= self.chunk_size:
+                # Messages are written backwards through the chunks, so older ones are in the previous chunk
+                if chunk == 0:
+                    read_has_wrapped = True
+                    if not write_has_wrapped:
+                        return
+                chunk = (chunk - 1) % self.chunks_per_slot
+                offset = self.first_message_in_chunk(self.chunk_buf(slot_start, chunk))
+
+            if read_has_wrapped and chunk == write_chunk and offset >= end_offset:
+                return
+
+            address = self.chunk_buf(slot_start, chunk) + offset
+            format_offset, facility, time_stamp, args = self.read_message(address)
+            if time_stamp == 0:
+                return
+
+            yield thread_id, time_stamp, facility, format_offset, args
+            offset += 16 + len(args) * self.pointer_size
+
+    def messages(self):
+        result = []
+        for slot in range(min(self.slots_used, self.slot_count)):
+            result.extend(self.thread_messages(slot))
+        result.sort(key=lambda message: message[1])
+        return result
+
+class FormatStrings:
+    def __init__(self, log, module_path):
+        self.log = log
+        self.module = open(module_path, 'rb') if module_path else None
+        self.cache = {}
+
+    def get(self, format_offset):
+        if format_offset in self.cache:
+            return self.cache[format_offset]
+
+        result = None
+        if self.module is not None:
+            for module_offset, file_offset, size in self.log.segments:
+                if module_offset <= format_offset < module_offset + size:
+                    self.module.seek(file_offset + format_offset - module_offset)
+                    chunk = self.module.read(1024)
+                    result = chunk.split(b'\0', 1)[0].decode('utf-8', 'replace')
+                    break
+
+        if result is None:
+            result = '<format string at module offset 0x%x>' % format_offset
+        self.cache[format_offset] = result
+        return result
+
+def format_message(format_string, args):
+    remaining = list(args)
+
+    def next_arg():
+        return remaining.pop(0) if remaining else 0
+
+    def replace(match):
+        flags, width, precision, length, conversion, extension = match.groups()
+        if conversion == '%':
+            return '%' + extension
+        value = next_arg()
+        if conversion == 'p':
+            text = '%016x' % value if value >> 32 else '%08x' % value
+            return text + {'T': ' (type)', 'M': ' (method)', 'K': ' (code)'}.get(extension, '')
+        if conversion in 'sS':
+            # Strings are not in the log, only their addresses
+            return '<string at %x>' % value + extension
+        if conversion == 'c':
+            return chr(value & 0xFF) + extension
+        bits = 64 if length in ('ll', 'l', 'z', 'I64', 'I') else 32
+        value &= (1 << bits) - 1
+        if conversion in 'di' and value >> (bits - 1):
+            value -= 1 << bits
+        spec = '%' + flags + width + ('.' + precision if precision else '') + ('d' if conversion in 'diu' else conversion)
+        return (spec % value) + extension
+
+    return FORMAT_SPEC.sub(replace, format_string)
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Decode a memory mapped stress log file.')
+    parser.add_argument('log_file', help='the stress log file (RH_StressLogFile)')
+    parser.add_argument('--module', help='module the format strings are read from, defaults to the one recorded in the log')
+    parser.add_argument('--seconds', type=float, help='only print the messages logged in the last SECONDS seconds')
+    args = parser.parse_args(argv)
+
+    with open(args.log_file, 'rb') as f:
+        log = LogFile(f.read())
+
+    module_path = args.module or log.module_path
+    try:
+        strings = FormatStrings(log, module_path)
+    except IOError as e:
+        sys.stderr.write('cannot read format strings from %s: %s\n' % (module_path, e))
+        strings = FormatStrings(log, None)
+
+    messages = log.messages()
+    if args.seconds is not None and messages:
+        newest = messages[-1][1]
+        oldest = newest - int(args.seconds * log.tick_frequency)
+        messages = [message for message in messages if message[1] >= oldest]
+
+    for thread_id, time_stamp, facility, format_offset, message_args in messages:
+        seconds = float(time_stamp - log.start_time_stamp) / log.tick_frequency
+        text = format_message(strings.get(format_offset), message_args)
+        sys.stdout.write('%5x %13.9f : %08x %s' % (thread_id, seconds, facility, text))
+        if not text.endswith('\n'):
+            sys.stdout.write('\n')
+
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -292,6 +292,21 @@ public:
     //  Address of the allocated memory
     static void* VirtualReserveAndCommitLargePages(size_t size);
 
+    // Get the size of the transparent huge pages the OS backs the committed memory with
+    // Return:
+    //  Size of a transparent huge page, or 0 if they are not used
+    static size_t GetTransparentHugePageSize();
+
+    // Make the pages of a committed virtual memory range that haven't been touched yet preferably
+    // allocated on the specified NUMA node. Pages that are already backed by memory are not moved.
+    // Parameters:
+    //  address - starting virtual address, page aligned
+    //  size    - size of the virtual memory range
+    //  node    - the NUMA node
+    // Return:
+    //  true if it has succeeded, false if it has failed
+    static bool VirtualBindToNumaNode(void *address, size_t size, uint16_t node);
+
     // Decomit virtual memory range.
     // Parameters:
     //  address - starting virtual address
@@ -447,6 +462,18 @@ public:
     //  Any parameter can be null.
     static void GetMemoryStatus(uint64_t restricted_limit, uint32_t* memory_load, uint64_t* available_physical, uint64_t* available_page_file);
 
+    // Check if the OS can notify the process about memory pressure
+    static bool CanWaitForMemoryPressure();
+
+    // Wait for the OS to report memory pressure on the process
+    // Parameters:
+    //  timeout - timeout in milliseconds, or INFINITE
+    // Return:
+    //  true if memory pressure was reported, false if the wait timed out or failed
+    // Remarks:
+    //  Only one thread may wait at a time.
+    static bool WaitForMemoryPressure(uint32_t timeout);
+
     // Get size of an OS memory page
     static size_t GetPageSize();
 
@@ -457,6 +484,14 @@ public:
     // Flush write buffers of processors that are executing threads of the current process
     static void FlushProcessWriteBuffers();
 
+    // Get statistics about the FlushProcessWriteBuffers calls made so far
+    // Parameters:
+    //  flushCount    - set to the number of flushes
+    //  totalTimeNs   - set to the total time spent flushing, in nanoseconds
+    //  maxTimeNs     - set to the longest single flush, in nanoseconds
+    //  fallbackCount - set to the number of flushes that couldn't use the preferred OS mechanism
+    static void GetFlushProcessWriteBuffersStats(uint64_t* flushCount, uint64_t* totalTimeNs, uint64_t* maxTimeNs, uint64_t* fallbackCount);
+
     // Break into a debugger
     static void DebugBreak();
 
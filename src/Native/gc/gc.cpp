@@ -69,10 +69,32 @@ static size_t smoothed_desired_per_heap = 0;
 
 #define LOH_PIN_QUEUE_LENGTH 100
 #define LOH_PIN_DECAY 10
+// Size of the address ranges server GC threads relocate references in the
+// compacted LOH in (see plan_loh)
+#define LOH_RELOC_UNIT_SIZE (1024*1024)
 
 uint32_t yp_spin_count_unit = 0;
 size_t loh_size_threshold = LARGE_OBJECT_SIZE;
 
+#ifdef FEATURE_CARD_MARKING_STEALING
+// Set in init_semi_shared from CARD_MARKING_STEALING_GRANULARITY or the
+// GCCardMarkingStealingGranularity config.
+size_t card_marking_stealing_granularity = 0;
+#endif //FEATURE_CARD_MARKING_STEALING
+
+#ifdef BACKGROUND_GC
+// This heap's share of the GCFragCompactMaxGen2Size config, which is the gen2
+// live size summed over all heaps above which high gen2 fragmentation alone
+// does not make us do a blocking (and compacting) gen2 - 0 means no limit.
+size_t frag_compact_max_gen2_size = 0;
+// Percentage of gen2 that is free space above which we do the blocking gen2
+// for fragmentation even when gen2 is bigger than frag_compact_max_gen2_size.
+// This only limits how far fragmentation can grow while the compaction is put
+// off - the compaction, when it happens, still covers all of gen2 and can be
+// longer than it would have been without the delay.
+size_t frag_compact_ceiling_percent = 0;
+#endif //BACKGROUND_GC
+
 #ifdef GC_CONFIG_DRIVEN
 int compact_ratio = 0;
 #endif //GC_CONFIG_DRIVEN
@@ -733,6 +755,43 @@ class t_join
     uint64_t elapsed_total[gc_join_max], wake_total[gc_join_max], seq_loss_total[gc_join_max], par_loss_total[gc_join_max], in_join_total[gc_join_max];
 #endif //JOIN_STATS
 
+    // Join statistics of the GC in progress, and of the last GC that ended (see publish_stats).
+    // The per heap statistics are only kept if they could be allocated.
+    gc_join_stats current_stats;
+    gc_join_stats last_stats;
+    gc_join_heap_stats* current_heap_stats;
+    gc_join_heap_stats* last_heap_stats;
+    // when the last thread arrived at the current join
+    uint64_t serial_start;
+
+    void reset_current_stats()
+    {
+        memset (&current_stats, 0, sizeof (current_stats));
+        for (int i = 0; i < GC_JOIN_STATS_MAX_STAGES; i++)
+        {
+            current_stats.stages[i].last_heap = -1;
+        }
+
+        if (current_heap_stats)
+        {
+            memset (current_heap_stats, 0, join_struct.n_threads * sizeof (gc_join_heap_stats));
+        }
+    }
+
+    void record_wait (gc_heap* gch, int join_id, uint64_t wait_start, BOOL blocked_p)
+    {
+        uint64_t wait_time = GetHighPrecisionTimeStamp() - wait_start;
+        gc_join_stage_stats* stage = &current_stats.stages[join_id];
+
+        Interlocked::Increment (blocked_p ? &stage->block_count : &stage->spin_count);
+        Interlocked::ExchangeAdd64 (&stage->wait_time, wait_time);
+
+        if (current_heap_stats)
+        {
+            current_heap_stats[gch->heap_number].wait_time += wait_time;
+        }
+    }
+
 public:
     BOOL init (int n_th, gc_join_flavor f)
     {
@@ -761,6 +820,17 @@ public:
         join_struct.wait_done = FALSE;
         flavor = f;
 
+        if (!current_heap_stats)
+        {
+            current_heap_stats = new (nothrow) gc_join_heap_stats [n_th * 2];
+            if (current_heap_stats)
+            {
+                last_heap_stats = current_heap_stats + n_th;
+                memset (last_heap_stats, 0, n_th * sizeof (gc_join_heap_stats));
+            }
+        }
+        reset_current_stats();
+
 #ifdef JOIN_STATS
         start_tick = GCToOSInterface::GetLowPrecisionTimeStamp();
 #endif //JOIN_STATS
@@ -800,6 +870,9 @@ public:
 
             fire_event (gch->heap_number, time_start, type_join, join_id);
 
+            uint64_t wait_start = GetHighPrecisionTimeStamp();
+            BOOL blocked_p = FALSE;
+
             //busy wait around the color
             if (color == join_struct.lock_color.LoadWithoutBarrier())
             {
@@ -820,6 +893,7 @@ respin:
                     dprintf (JOIN_LOG, ("join%d(%d): Join() hard wait on reset event %d, join_lock is now %d",
                         flavor, join_id, color, (int32_t)(join_struct.join_lock)));
 
+                    blocked_p = TRUE;
                     uint32_t dwJoinWait = join_struct.joined_event[color].Wait(INFINITE, FALSE);
 
                     if (dwJoinWait != WAIT_OBJECT_0)
@@ -839,6 +913,8 @@ respin:
                     flavor, join_id, (int32_t)(join_struct.join_lock)));
             }
 
+            record_wait (gch, join_id, wait_start, blocked_p);
+
             fire_event (gch->heap_number, time_end, type_join, join_id);
 
 #ifdef JOIN_STATS
@@ -855,6 +931,15 @@ respin:
             dprintf (JOIN_LOG, ("join%d(%d): Last thread to complete the join, setting id", flavor, join_id));
             join_struct.joined_event[!color].Reset();
             id = join_id;
+
+            gc_join_stage_stats* stage = &current_stats.stages[join_id];
+            stage->join_count++;
+            stage->last_heap = gch->heap_number;
+            if (current_heap_stats)
+            {
+                current_heap_stats[gch->heap_number].last_arrival_count++;
+            }
+            serial_start = GetHighPrecisionTimeStamp();
 #ifdef JOIN_STATS
             // remember the join id, the last thread arriving, the start of the sequential phase,
             // and keep track of the cycles spent waiting in the join
@@ -883,6 +968,9 @@ respin:
 
             dprintf (JOIN_LOG, ("r_join() Waiting..."));
 
+            uint64_t wait_start = GetHighPrecisionTimeStamp();
+            BOOL blocked_p = FALSE;
+
             //busy wait around the color
 respin:
             int spin_count = 256 * yp_spin_count_unit;
@@ -899,6 +987,7 @@ respin:
             if (!join_struct.wait_done)
             {
                 dprintf (JOIN_LOG, ("Join() hard wait on reset event %d", first_thread_arrived));
+                blocked_p = TRUE;
                 uint32_t dwJoinWait = join_struct.joined_event[first_thread_arrived].Wait(INFINITE, FALSE);
                 if (dwJoinWait != WAIT_OBJECT_0)
                 {
@@ -915,6 +1004,8 @@ respin:
 
             dprintf (JOIN_LOG, ("r_join() done"));
 
+            record_wait (gch, join_id, wait_start, blocked_p);
+
             fire_event (gch->heap_number, time_end, type_join, join_id);
 
             return FALSE;
@@ -994,6 +1085,8 @@ respin:
         }
 #endif //JOIN_STATS
 
+        current_stats.stages[id].serial_time += GetHighPrecisionTimeStamp() - serial_start;
+
         fire_event (join_heap_restart, time_start, type_restart, -1);
         assert (join_struct.joined_p);
         join_struct.joined_p = FALSE;
@@ -1036,8 +1129,48 @@ respin:
             join_struct.joined_event[first_thread_arrived].Reset();
         }
     }
+
+    // Makes the statistics of the GC that just ended the ones get_stats returns, and starts
+    // over for the next GC. Threads that are still on their way out of the GC's last join
+    // when this is called count their wait towards the next GC.
+    void publish_stats (uint64_t gc_index)
+    {
+        current_stats.gc_index = gc_index;
+        current_stats.heap_count = join_struct.n_threads;
+        current_stats.stage_count = gc_join_max;
+        memcpy (&last_stats, &current_stats, sizeof (last_stats));
+
+        if (current_heap_stats)
+        {
+            memcpy (last_heap_stats, current_heap_stats, join_struct.n_threads * sizeof (gc_join_heap_stats));
+        }
+
+        reset_current_stats();
+    }
+
+    int get_stats (gc_join_stats* stats, gc_join_heap_stats* heap_stats, int heap_stats_count)
+    {
+        memcpy (stats, &last_stats, sizeof (last_stats));
+
+        int copy_count = min (heap_stats_count, join_struct.n_threads);
+        if (copy_count > 0)
+        {
+            if (last_heap_stats)
+            {
+                memcpy (heap_stats, last_heap_stats, copy_count * sizeof (gc_join_heap_stats));
+            }
+            else
+            {
+                memset (heap_stats, 0, copy_count * sizeof (gc_join_heap_stats));
+            }
+        }
+
+        return join_struct.n_threads;
+    }
 };
 
+static_assert (gc_join_max <= GC_JOIN_STATS_MAX_STAGES, "gc_join_stats needs room for every join stage");
+
 t_join gc_t_join;
 
 #ifdef BACKGROUND_GC
@@ -1890,6 +2023,9 @@ const int max_snoop_level = 128;
 // time in milliseconds between decommit steps
 #define DECOMMIT_TIME_STEP_MILLISECONDS (100)
 
+// how many times larger a decommit step is under high memory load
+#define HIGH_MEMORY_LOAD_DECOMMIT_STEP_FACTOR (8)
+
 inline
 size_t align_on_page (size_t add)
 {
@@ -2004,6 +2140,7 @@ void stomp_write_barrier_initialize(uint8_t* ephemeral_low, uint8_t* ephemeral_h
     args.highest_address = g_gc_highest_address;
     args.ephemeral_low = ephemeral_low;
     args.ephemeral_high = ephemeral_high;
+    args.precise_card_marking = GCConfig::GetGCPreciseCardMarking();
     GCToEEInterface::StompWriteBarrier(&args);
 }
 
@@ -2177,6 +2314,12 @@ uint64_t    gc_heap::suspended_start_time = 0;
 uint64_t    gc_heap::end_gc_time = 0;
 uint64_t    gc_heap::total_suspended_time = 0;
 uint64_t    gc_heap::process_start_time = 0;
+gc_pause_histogram gc_heap::pause_histograms[gc_pause_kind_count];
+gc_history_record* gc_heap::history_records = 0;
+size_t      gc_heap::history_size = 0;
+uint64_t    gc_heap::history_count = 0;
+VOLATILE(uint32_t) gc_heap::history_version = 0;
+uint64_t    gc_heap::relocate_compact_duration = 0;
 last_recorded_gc_info gc_heap::last_ephemeral_gc_info;
 last_recorded_gc_info gc_heap::last_full_blocking_gc_info;
 
@@ -2364,6 +2507,12 @@ uint8_t*    gc_heap::oldest_pinned_plug = 0;
 
 size_t      gc_heap::num_pinned_objects = 0;
 
+size_t      gc_heap::num_pinned_plugs = 0;
+
+size_t      gc_heap::pinned_plug_size = 0;
+
+size_t      gc_heap::pinned_plug_fragmentation = 0;
+
 #ifdef FEATURE_LOH_COMPACTION
 size_t      gc_heap::loh_pinned_queue_tos = 0;
 
@@ -2532,6 +2681,7 @@ uint64_t gc_heap::total_loh_a_last_bgc = 0;
 size_t gc_heap::eph_gen_starts_size = 0;
 heap_segment* gc_heap::segment_standby_list;
 bool          gc_heap::use_large_pages_p = 0;
+size_t        gc_heap::transparent_huge_page_size = 0;
 #ifdef HEAP_BALANCE_INSTRUMENTATION
 size_t        gc_heap::last_gc_end_time_us = 0;
 #endif //HEAP_BALANCE_INSTRUMENTATION
@@ -2721,7 +2871,7 @@ void gc_history_per_heap::print()
         gen_data[i].print (heap_index, i);
     }
 
-    dprintf (DT_LOG_0, ("fla %Id flr %Id esa %Id ca %Id pa %Id paa %Id, rfle %d, ec %Id",
+    dprintf (DT_LOG_0, ("fla %Id flr %Id esa %Id ca %Id pa %Id paa %Id, rfle %d, ec %Id, cm %Idus(s %Idus), rn %Id",
                     maxgen_size_info.free_list_allocated,
                     maxgen_size_info.free_list_rejected,
                     maxgen_size_info.end_seg_allocated,
@@ -2729,7 +2879,10 @@ void gc_history_per_heap::print()
                     maxgen_size_info.pinned_allocated,
                     maxgen_size_info.pinned_allocated_advance,
                     maxgen_size_info.running_free_list_efficiency,
-                    extra_gen0_committed));
+                    extra_gen0_committed,
+                    card_mark_time,
+                    card_mark_steal_time,
+                    remote_node_alloc_switches));
 
     int mechanism = 0;
     gc_mechanism_descr* descr = 0;
@@ -2806,6 +2959,7 @@ void gc_heap::fire_pevents()
 
     settings.record (current_gc_data_global);
     current_gc_data_global->print();
+    record_history (current_gc_data_global);
 
     FIRE_EVENT(GCGlobalHeapHistory_V3,
                current_gc_data_global->final_youngest_desired,
@@ -4198,6 +4352,11 @@ heap_segment* make_initial_segment (int gen, int h_number)
     gc_oh_num oh = gen_to_oh (gen);
     heap_segment* res = gc_heap::make_heap_segment ((uint8_t*)mem, size, oh, h_number);
 
+    if (res)
+    {
+        gc_heap::bind_tables_to_heap_numa_node ((uint8_t*)mem, (uint8_t*)mem + size, h_number);
+    }
+
     return res;
 }
 
@@ -4582,6 +4741,8 @@ gc_heap::get_segment (size_t size, gc_oh_num oh)
                 virtual_free (mem, size);
                 return 0;
             }
+
+            bind_tables_to_heap_numa_node ((uint8_t*)mem, (uint8_t*)mem + size, heap_number);
         }
         else
         {
@@ -5472,6 +5633,7 @@ void gc_heap::gc_thread_function ()
             BEGIN_TIMING(suspend_ee_during_log);
             GCToEEInterface::SuspendEE(SUSPEND_FOR_GC);
             END_TIMING(suspend_ee_during_log);
+            record_suspension();
 
             proceed_with_gc_p = TRUE;
 
@@ -5580,10 +5742,10 @@ void gc_heap::gc_thread_function ()
 
 bool gc_heap::virtual_alloc_commit_for_heap (void* addr, size_t size, int h_number)
 {
-#if defined(MULTIPLE_HEAPS) && !defined(FEATURE_REDHAWK)
+#ifdef MULTIPLE_HEAPS
     // Currently there is no way for us to specific the numa node to allocate on via hosting interfaces to
     // a host. This will need to be added later.
-#if !defined(FEATURE_CORECLR) && !defined(BUILD_AS_STANDALONE)
+#if !defined(FEATURE_CORECLR) && !defined(BUILD_AS_STANDALONE) && !defined(FEATURE_REDHAWK)
     if (!CLRMemoryHosted())
 #endif
     {
@@ -5594,9 +5756,9 @@ bool gc_heap::virtual_alloc_commit_for_heap (void* addr, size_t size, int h_numb
                 return true;
         }
     }
-#else //MULTIPLE_HEAPS && !FEATURE_REDHAWK
+#else //MULTIPLE_HEAPS
     UNREFERENCED_PARAMETER(h_number);
-#endif //MULTIPLE_HEAPS && !FEATURE_REDHAWK
+#endif //MULTIPLE_HEAPS
 
     //numa aware not enabled, or call failed --> fallback to VirtualCommit()
     return GCToOSInterface::VirtualCommit(addr, size);
@@ -7354,6 +7516,52 @@ uint32_t* gc_heap::make_card_table (uint8_t* start, uint8_t* end)
     return translate_card_table(ct);
 }
 
+// The card table, brick table and mark array are committed for all the heaps at once, or by
+// whichever thread needs them first, so without this their pages would end up on the node of the
+// thread that first touches them. The pages that only describe the heap's own range are bound to
+// the heap's node instead.
+void gc_heap::bind_to_heap_numa_node (uint8_t* begin, uint8_t* end, int h_number)
+{
+#ifdef MULTIPLE_HEAPS
+    if ((h_number < 0) || use_large_pages_p || !GCToOSInterface::CanEnableGCNumaAware())
+        return;
+
+    // The pages at either end may describe the ranges of other heaps as well.
+    uint8_t* bind_start = align_on_page (begin);
+    uint8_t* bind_end = align_lower_page (end);
+    if (bind_start < bind_end)
+    {
+        uint16_t numa_node = heap_select::find_numa_node_from_heap_no (h_number);
+        GCToOSInterface::VirtualBindToNumaNode (bind_start, (size_t)(bind_end - bind_start), numa_node);
+    }
+#else //MULTIPLE_HEAPS
+    UNREFERENCED_PARAMETER(begin);
+    UNREFERENCED_PARAMETER(end);
+    UNREFERENCED_PARAMETER(h_number);
+#endif //MULTIPLE_HEAPS
+}
+
+void gc_heap::bind_tables_to_heap_numa_node (uint8_t* start, uint8_t* end, int h_number)
+{
+#ifdef MULTIPLE_HEAPS
+    if ((start < g_gc_lowest_address) || (end > g_gc_highest_address))
+        return;
+
+    bind_to_heap_numa_node ((uint8_t*)&g_gc_card_table[card_word (gcard_of (start))],
+                            (uint8_t*)&g_gc_card_table[card_word (gcard_of (end))],
+                            h_number);
+
+    short* bt = card_table_brick_table (&g_gc_card_table[card_word (gcard_of (g_gc_lowest_address))]);
+    bind_to_heap_numa_node ((uint8_t*)&bt[(start - g_gc_lowest_address) / brick_size],
+                            (uint8_t*)&bt[(end - g_gc_lowest_address) / brick_size],
+                            h_number);
+#else //MULTIPLE_HEAPS
+    UNREFERENCED_PARAMETER(start);
+    UNREFERENCED_PARAMETER(end);
+    UNREFERENCED_PARAMETER(h_number);
+#endif //MULTIPLE_HEAPS
+}
+
 void gc_heap::set_fgm_result (failure_get_memory f, size_t s, BOOL loh_p)
 {
 #ifdef MULTIPLE_HEAPS
@@ -9358,6 +9566,16 @@ size_t gc_heap::decommit_heap_segment_pages_worker (heap_segment* seg,
 {
     assert (!use_large_pages_p);
     uint8_t* page_start = align_on_page (new_committed);
+    if (transparent_huge_page_size != 0)
+    {
+        // Don't split the huge page that new_committed falls into - we'd lose the
+        // huge page for the part we keep committed.
+        page_start = (uint8_t*)(((size_t)page_start + transparent_huge_page_size - 1) & ~(transparent_huge_page_size - 1));
+        if (page_start >= heap_segment_committed (seg))
+        {
+            return 0;
+        }
+    }
     size_t size = heap_segment_committed (seg) - page_start;
     if (size > 0)
     {
@@ -10098,6 +10316,17 @@ HRESULT gc_heap::initialize_gc (size_t soh_segment_size,
                                          static_cast<int>(GCEventStatus::GetEnabledKeywords(GCEventProvider_Private)));
 #endif // __linux__
 
+    // The history is only for diagnostics, so not being able to allocate it just disables it.
+    history_size = (size_t)GCConfig::GetGCHistorySize();
+    if (history_size != 0)
+    {
+        history_records = new (nothrow) gc_history_record [history_size];
+        if (!history_records)
+        {
+            history_size = 0;
+        }
+    }
+
     if (!init_semi_shared())
     {
         hres = E_FAIL;
@@ -10199,6 +10428,25 @@ gc_heap::init_semi_shared()
     loh_size_threshold = (size_t)GCConfig::GetLOHThreshold();
     assert (loh_size_threshold >= LARGE_OBJECT_SIZE);
 
+#ifdef FEATURE_CARD_MARKING_STEALING
+    {
+        // Smaller chunks let idle heaps steal more of the work when old to young references
+        // are concentrated on a few heaps, at the cost of more interlocked increments on the
+        // chunk index. A chunk needs to cover at least 1 card bundle bit.
+        size_t granularity_from_config = (size_t)GCConfig::GetGCCardMarkingStealingGranularity();
+        if (granularity_from_config != 0)
+        {
+            card_marking_stealing_granularity = max (round_up_power2 (granularity_from_config),
+                                                     (size_t)MIN_CARD_MARKING_STEALING_GRANULARITY);
+        }
+        else
+        {
+            card_marking_stealing_granularity = CARD_MARKING_STEALING_GRANULARITY;
+        }
+        dprintf (GTC_LOG, ("card marking stealing granularity: %Id", card_marking_stealing_granularity));
+    }
+#endif //FEATURE_CARD_MARKING_STEALING
+
 #ifdef BGC_SERVO_TUNING
     memset (bgc_tuning::gen_calc, 0, sizeof (bgc_tuning::gen_calc));
     memset (bgc_tuning::gen_stats, 0, sizeof (bgc_tuning::gen_stats));
@@ -10284,6 +10532,20 @@ gc_heap::init_semi_shared()
     bgc_alloc_spin_count = static_cast<uint32_t>(GCConfig::GetBGCSpinCount());
     bgc_alloc_spin = static_cast<uint32_t>(GCConfig::GetBGCSpin());
 
+    {
+        // The config specifies the total over all heaps, we compare each heap's gen2 with its share.
+        frag_compact_max_gen2_size = (size_t)GCConfig::GetGCFragCompactMaxGen2Size();
+#ifdef MULTIPLE_HEAPS
+        frag_compact_max_gen2_size /= n_heaps;
+#endif //MULTIPLE_HEAPS
+
+        frag_compact_ceiling_percent = (size_t)GCConfig::GetGCFragCompactCeilingPercent();
+        if ((frag_compact_ceiling_percent == 0) || (frag_compact_ceiling_percent > 100))
+        {
+            frag_compact_ceiling_percent = 50;
+        }
+    }
+
     {
         int number_bgc_threads = 1;
 #ifdef MULTIPLE_HEAPS
@@ -10342,6 +10604,7 @@ gc_heap* gc_heap::make_gc_heap (
 
     res->vm_heap = vm_hp;
     res->alloc_context_count = 0;
+    res->remote_node_alloc_switches = 0;
 
 #ifdef MARK_LIST
 #ifdef PARALLEL_MARK_LIST_SORT
@@ -10570,6 +10833,14 @@ gc_heap::init_gc_heap (int  h_number)
 
     loh_pinned_queue = 0;
 
+#ifdef MULTIPLE_HEAPS
+    loh_reloc_units = 0;
+
+    loh_reloc_units_length = 0;
+
+    loh_reloc_unit_count = 0;
+#endif //MULTIPLE_HEAPS
+
     min_overflow_address = MAX_PTR;
 
     max_overflow_address = 0;
@@ -13760,6 +14031,14 @@ try_again:
                     org_hp->alloc_context_count--;
                     max_hp->alloc_context_count++;
 
+                    if (heap_select::find_numa_node_from_heap_no (org_hp_num) !=
+                        heap_select::find_numa_node_from_heap_no (final_alloc_hp_num))
+                    {
+                        // Objects allocated from here on will live in memory that's remote
+                        // to the allocating thread until it migrates.
+                        Interlocked::Increment (&max_hp->remote_node_alloc_switches);
+                    }
+
                     acontext->set_alloc_heap (GCHeap::GetHeap (final_alloc_hp_num));
                     if (!gc_thread_no_affinitize_p)
                     {
@@ -15820,7 +16099,30 @@ int gc_heap::generation_to_condemn (int n_initial,
             local_condemn_reasons->set_condition (gen_max_high_frag_p);
             if (local_settings->pause_mode != pause_sustained_low_latency)
             {
-                *blocking_collection_p = TRUE;
+#ifdef BACKGROUND_GC
+                // Compacting gen2 takes time proportional to what survives in it so on a
+                // big gen2 we'd rather keep doing BGCs and let gen1 GCs fill in the free
+                // list, as long as we are not under memory pressure and the free space
+                // has not grown past the ceiling. This postpones the blocking compaction,
+                // it doesn't make it any shorter.
+                generation* gen2 = generation_of (max_generation);
+                size_t gen2_size = generation_size (max_generation);
+                size_t gen2_free_size = generation_free_list_space (gen2) +
+                                        generation_free_obj_space (gen2);
+                size_t gen2_live_size = gen2_size - gen2_free_size;
+                if ((frag_compact_max_gen2_size != 0) &&
+                    (gen2_live_size > frag_compact_max_gen2_size) &&
+                    (gen2_free_size < (gen2_size / 100) * frag_compact_ceiling_percent) &&
+                    !high_memory_load)
+                {
+                    dprintf (GTC_LOG, ("h%d: g2 live %Id > %Id, free %Id of %Id, not blocking for frag",
+                        heap_number, gen2_live_size, frag_compact_max_gen2_size, gen2_free_size, gen2_size));
+                }
+                else
+#endif //BACKGROUND_GC
+                {
+                    *blocking_collection_p = TRUE;
+                }
             }
         }
     }
@@ -16156,11 +16458,21 @@ void gc_heap::gc1()
         else
 #endif //BACKGROUND_GC
         {
+            uint64_t mark_start = GetHighPrecisionTimeStamp();
             mark_phase (n, FALSE);
+            uint64_t plan_start = GetHighPrecisionTimeStamp();
 
             GCScan::GcRuntimeStructuresValid (FALSE);
             plan_phase (n);
             GCScan::GcRuntimeStructuresValid (TRUE);
+
+            if (heap_number == 0)
+            {
+                uint64_t plan_end = GetHighPrecisionTimeStamp();
+                record_pause (gc_pause_mark, plan_start - mark_start);
+                record_pause (gc_pause_plan, plan_end - plan_start - relocate_compact_duration);
+                relocate_compact_duration = 0;
+            }
         }
     }
 
@@ -17307,6 +17619,9 @@ void gc_heap::init_records()
 
 #ifdef MULTIPLE_HEAPS
     gen0_allocated_after_gc_p = false;
+
+    gc_data_per_heap.remote_node_alloc_switches = remote_node_alloc_switches;
+    remote_node_alloc_switches = 0;
 #endif //MULTIPLE_HEAPS
 
 #if defined (_DEBUG) && defined (VERIFY_HEAP)
@@ -17405,6 +17720,9 @@ void gc_heap::garbage_collect (int n)
 
     settings.reason = gc_trigger_reason;
     num_pinned_objects = 0;
+    num_pinned_plugs = 0;
+    pinned_plug_size = 0;
+    pinned_plug_fragmentation = 0;
 
 #ifdef STRESS_HEAP
     if (settings.reason == reason_gcstress)
@@ -20291,6 +20609,8 @@ void gc_heap::mark_phase (int condemned_gen_number, BOOL mark_only_p)
             }
 #endif //HEAP_ANALYZE
 
+            uint64_t card_mark_start = GetHighPrecisionTimeStamp();
+
 #if defined(MULTIPLE_HEAPS) && defined(FEATURE_CARD_MARKING_STEALING)
             if (!card_mark_done_soh)
 #endif // MULTIPLE_HEAPS && FEATURE_CARD_MARKING_STEALING
@@ -20321,6 +20641,8 @@ void gc_heap::mark_phase (int condemned_gen_number, BOOL mark_only_p)
             }
 
 #if defined(MULTIPLE_HEAPS) && defined(FEATURE_CARD_MARKING_STEALING)
+            uint64_t card_mark_steal_start = GetHighPrecisionTimeStamp();
+
             // check the other heaps cyclically and try to help out where the marking isn't done
             for (int i = 0; i < gc_heap::n_heaps; i++)
             {
@@ -20347,8 +20669,14 @@ void gc_heap::mark_phase (int condemned_gen_number, BOOL mark_only_p)
                     hp->card_mark_done_uoh = true;
                 }
             }
+
+            gc_data_per_heap.card_mark_steal_time = (size_t)(GetHighPrecisionTimeStamp() - card_mark_steal_start);
 #endif // MULTIPLE_HEAPS && FEATURE_CARD_MARKING_STEALING
 
+            gc_data_per_heap.card_mark_time = (size_t)(GetHighPrecisionTimeStamp() - card_mark_start);
+            dprintf (3, ("h%d card marking took %Idus (%Idus helping other heaps)",
+                heap_number, gc_data_per_heap.card_mark_time, gc_data_per_heap.card_mark_steal_time));
+
             dprintf (3, ("marked by cards: %Id",
                 (promoted_bytes (heap_number) - promoted_before_cards)));
             fire_mark_event (heap_number, ETW::GC_ROOT_OLDER, (promoted_bytes (heap_number) - last_promoted_bytes));
@@ -20626,6 +20954,29 @@ size_t gc_heap::get_total_pinned_objects()
 #endif //MULTIPLE_HEAPS
 }
 
+void gc_heap::get_total_pinned_plug_info (size_t* plug_count, size_t* plug_size, size_t* plug_fragmentation)
+{
+#ifdef MULTIPLE_HEAPS
+    size_t total_plug_count = 0;
+    size_t total_plug_size = 0;
+    size_t total_plug_fragmentation = 0;
+    for (int i = 0; i < gc_heap::n_heaps; i++)
+    {
+        gc_heap* hp = gc_heap::g_heaps[i];
+        total_plug_count += hp->num_pinned_plugs;
+        total_plug_size += hp->pinned_plug_size;
+        total_plug_fragmentation += hp->pinned_plug_fragmentation;
+    }
+    *plug_count = total_plug_count;
+    *plug_size = total_plug_size;
+    *plug_fragmentation = total_plug_fragmentation;
+#else //MULTIPLE_HEAPS
+    *plug_count = num_pinned_plugs;
+    *plug_size = pinned_plug_size;
+    *plug_fragmentation = pinned_plug_fragmentation;
+#endif //MULTIPLE_HEAPS
+}
+
 void gc_heap::reset_mark_stack ()
 {
     reset_pinned_queue();
@@ -21560,6 +21911,15 @@ BOOL gc_heap::plan_loh()
     uint8_t* free_space_end = o;
     uint8_t* new_address = 0;
 
+#ifdef MULTIPLE_HEAPS
+    // Split the LOH into ranges of about LOH_RELOC_UNIT_SIZE bytes, each starting at an
+    // object, so the relocate phase can spread the work within a segment over the heaps.
+    // Planning itself stays on this heap's thread, it has to give out the new addresses
+    // in order.
+    BOOL record_reloc_units_p = reserve_loh_reloc_units();
+    uint8_t* reloc_unit_limit = 0;
+#endif //MULTIPLE_HEAPS
+
     while (1)
     {
         if (o >= heap_segment_allocated (seg))
@@ -21571,8 +21931,22 @@ BOOL gc_heap::plan_loh()
             }
 
             o = heap_segment_mem (seg);
+#ifdef MULTIPLE_HEAPS
+            reloc_unit_limit = 0;
+#endif //MULTIPLE_HEAPS
         }
 
+#ifdef MULTIPLE_HEAPS
+        if (record_reloc_units_p && (o >= reloc_unit_limit))
+        {
+            assert (loh_reloc_unit_count < loh_reloc_units_length);
+            loh_reloc_unit* unit = &loh_reloc_units[loh_reloc_unit_count++];
+            unit->seg = seg;
+            unit->start = o;
+            reloc_unit_limit = o + LOH_RELOC_UNIT_SIZE;
+        }
+#endif //MULTIPLE_HEAPS
+
         if (marked (o))
         {
             free_space_end = o;
@@ -21659,6 +22033,11 @@ BOOL gc_heap::plan_loh()
     return TRUE;
 }
 
+// Moves this heap's LOH objects to the addresses plan_loh gave them. Unlike the relocation
+// in relocate_in_loh_compact, the heaps don't share this work: objects slide down in address
+// order, so an object can land on the source of an earlier one, and the gaps in front of the
+// moved objects are threaded onto the free list as we go. Both need the objects to be
+// handled one at a time, in order.
 void gc_heap::compact_loh()
 {
     assert (loh_compaction_requested() || heap_hard_limit);
@@ -21789,25 +22168,97 @@ void gc_heap::compact_loh()
 void gc_heap::relocate_in_loh_compact()
 {
     generation* gen        = large_object_generation;
-    heap_segment* seg      = heap_segment_rw (generation_start_segment (gen));
-    uint8_t* o             = generation_allocation_start (gen);
 
-    //Skip the generation gap object
-    o = o + AlignQword (size (o));
-
-    while (1)
+#ifdef MULTIPLE_HEAPS
+    if (loh_reloc_unit_count != 0)
     {
-        if (o >= heap_segment_allocated (seg))
+        relocate_in_loh_compact_units();
+    }
+    else
+#endif //MULTIPLE_HEAPS
+    {
+        heap_segment* seg      = heap_segment_rw (generation_start_segment (gen));
+        uint8_t* o             = generation_allocation_start (gen);
+
+        //Skip the generation gap object
+        o = o + AlignQword (size (o));
+
+        while (seg)
         {
+            relocate_in_loh_compact_range (o, heap_segment_allocated (seg));
+
             seg = heap_segment_next (seg);
-            if (seg == 0)
+            if (seg)
             {
-                break;
+                o = heap_segment_mem (seg);
             }
+        }
+    }
 
-            o = heap_segment_mem (seg);
+    dprintf (1235, ("after GC LOH size: %Id, free list: %Id, free obj: %Id\n\n", 
+        generation_size (loh_generation), 
+        generation_free_list_space (gen),
+        generation_free_obj_space (gen)));
+}
+
+#ifdef MULTIPLE_HEAPS
+// Makes sure loh_reloc_units has room for the ranges plan_loh records in
+// this heap's LOH. Returns FALSE if it doesn't, in which case this heap
+// relocates in its LOH by itself.
+BOOL gc_heap::reserve_loh_reloc_units()
+{
+    loh_reloc_unit_count = 0;
+
+    // Each range but the last one of a segment spans at least LOH_RELOC_UNIT_SIZE bytes.
+    size_t units_needed = 0;
+    for (heap_segment* seg = heap_segment_rw (generation_start_segment (large_object_generation));
+         seg != 0;
+         seg = heap_segment_next (seg))
+    {
+        units_needed += (heap_segment_allocated (seg) - heap_segment_mem (seg)) / LOH_RELOC_UNIT_SIZE + 1;
+    }
+
+    if (units_needed > loh_reloc_units_length)
+    {
+        delete[] loh_reloc_units;
+        loh_reloc_units = new (nothrow) loh_reloc_unit [units_needed];
+        loh_reloc_units_length = loh_reloc_units ? units_needed : 0;
+        if (!loh_reloc_units)
+        {
+            dprintf (1, ("Cannot allocate %Id LOH relocation ranges, relocating the LOH alone", units_needed));
+            return FALSE;
         }
+    }
 
+    return TRUE;
+}
+
+// Relocates in the ranges of this heap's LOH no heap has claimed yet. Called
+// by this heap, and by the heaps that are done with their own relocation.
+void gc_heap::relocate_in_loh_compact_units()
+{
+    while (1)
+    {
+        size_t unit_index = (uint32_t)Interlocked::Increment ((volatile int32_t*)&loh_reloc_unit_index);
+        if (unit_index >= loh_reloc_unit_count)
+        {
+            break;
+        }
+
+        loh_reloc_unit* unit = &loh_reloc_units[unit_index];
+        loh_reloc_unit* next_unit = unit + 1;
+        uint8_t* end = (((unit_index + 1) < loh_reloc_unit_count) && (next_unit->seg == unit->seg)) ?
+                            next_unit->start : heap_segment_allocated (unit->seg);
+
+        relocate_in_loh_compact_range (unit->start, end);
+    }
+}
+#endif //MULTIPLE_HEAPS
+
+void gc_heap::relocate_in_loh_compact_range (uint8_t* o, uint8_t* end)
+{
+    while (o < end)
+    {
         if (marked (o))
         {
             size_t size = AlignQword (size (o));
@@ -21822,24 +22273,19 @@ void gc_heap::relocate_in_loh_compact()
             }
 
             o = o + size;
-            if (o < heap_segment_allocated (seg))
+            if (o < end)
             {
                 assert (!marked (o));
             }
         }
         else
         {
-            while (o < heap_segment_allocated (seg) && !marked (o))
+            while (o < end && !marked (o))
             {
                 o = o + AlignQword (size (o));
             }
         }
     }
-
-    dprintf (1235, ("after GC LOH size: %Id, free list: %Id, free obj: %Id\n\n", 
-        generation_size (loh_generation), 
-        generation_free_list_space (gen),
-        generation_free_obj_space (gen)));
 }
 
 void gc_heap::walk_relocation_for_loh (void* profiling_context, record_surv_fn fn)
@@ -22634,8 +23080,11 @@ void gc_heap::plan_phase (int condemned_gen_number)
                 {
                     assert (last_pinned_plug == plug_start);
                     set_pinned_info (plug_start, ps, consing_gen);
+                    num_pinned_plugs++;
                 }
 
+                pinned_plug_size += ps;
+
                 new_address = plug_start;
 
                 dprintf (3, ( "(%Ix)PP: [%Ix, %Ix[%Ix](m:%d)",
@@ -22973,6 +23422,16 @@ void gc_heap::plan_phase (int condemned_gen_number)
                                   heap_segment_allocated (ephemeral_heap_segment));
 
     dprintf (2,("Fragmentation: %Id", fragmentation));
+
+    // The free space in front of each pinned plug is what these plugs leave behind
+    // if we compact - this is the part of the fragmentation caused by pinning.
+    for (size_t pinned_index = 0; pinned_index < mark_stack_bos; pinned_index++)
+    {
+        pinned_plug_fragmentation += pinned_len (pinned_plug_of (pinned_index));
+    }
+
+    dprintf (2,("%Id pinned plugs (%Id bytes), %Id bytes in front of them",
+        num_pinned_plugs, pinned_plug_size, pinned_plug_fragmentation));
     dprintf (2,("---- End of Plan phase ----"));
 
     // We may update write barrier code.  We assume here EE has been suspended if we are on a GC thread.
@@ -23293,9 +23752,20 @@ void gc_heap::plan_phase (int condemned_gen_number)
 
         GCToEEInterface::DiagWalkSurvivors(__this, true);
 
+        uint64_t relocate_start = GetHighPrecisionTimeStamp();
         relocate_phase (condemned_gen_number, first_condemned_address);
+        uint64_t compact_start = GetHighPrecisionTimeStamp();
         compact_phase (condemned_gen_number, first_condemned_address,
                        (!settings.demotion && settings.promotion));
+
+        if (heap_number == 0)
+        {
+            uint64_t compact_end = GetHighPrecisionTimeStamp();
+            record_pause (gc_pause_relocate, compact_start - relocate_start);
+            record_pause (gc_pause_compact, compact_end - compact_start);
+            relocate_compact_duration = compact_end - relocate_start;
+        }
+
         fix_generation_bounds (condemned_gen_number, consing_gen);
         assert (generation_allocation_limit (youngest_generation) ==
                 generation_allocation_pointer (youngest_generation));
@@ -24919,6 +25389,11 @@ void gc_heap::relocate_phase (int condemned_gen_number,
     sc.promotion = FALSE;
     sc.concurrent = FALSE;
 
+#if defined(MULTIPLE_HEAPS) && defined(FEATURE_LOH_COMPACTION)
+    // set to all 1 bits so that incrementing it yields 0 as the first index
+    loh_reloc_unit_index = ~0u;
+#endif //MULTIPLE_HEAPS && FEATURE_LOH_COMPACTION
+
 #ifdef MULTIPLE_HEAPS
     //join all threads to make sure they are synchronized
     dprintf(3, ("Joining after end of plan"));
@@ -25078,6 +25553,23 @@ void gc_heap::relocate_phase (int condemned_gen_number,
     }
 #endif // MULTIPLE_HEAPS && FEATURE_CARD_MARKING_STEALING
 
+#if defined(MULTIPLE_HEAPS) && defined(FEATURE_LOH_COMPACTION)
+    if (settings.loh_compaction)
+    {
+        // check the other heaps cyclically and help relocate within the LOH ranges
+        // that haven't been claimed yet - a heap with a much bigger LOH than the others,
+        // or a single big LOH segment, would otherwise be relocated by one thread.
+        for (int i = 1; i < gc_heap::n_heaps; i++)
+        {
+            gc_heap* hp = gc_heap::g_heaps[(i + heap_number) % gc_heap::n_heaps];
+            if (hp->loh_compacted_p)
+            {
+                hp->relocate_in_loh_compact_units();
+            }
+        }
+    }
+#endif //MULTIPLE_HEAPS && FEATURE_LOH_COMPACTION
+
     dprintf(2,( "---- End of Relocate phase ----"));
 }
 
@@ -25867,6 +26359,12 @@ BOOL gc_heap::commit_mark_array_new_seg (gc_heap* hp,
     uint8_t* lowest = hp->background_saved_lowest_address;
     uint8_t* highest = hp->background_saved_highest_address;
 
+#ifdef MULTIPLE_HEAPS
+    int h_number = (heap_segment_read_only_p (seg) ? -1 : hp->heap_number);
+#else
+    int h_number = -1;
+#endif //MULTIPLE_HEAPS
+
     uint8_t* commit_start = NULL;
     uint8_t* commit_end = NULL;
     size_t commit_flag = 0;
@@ -25890,7 +26388,7 @@ BOOL gc_heap::commit_mark_array_new_seg (gc_heap* hp,
         commit_start = max (lowest, start);
         commit_end = min (highest, end);
 
-        if (!commit_mark_array_by_range (commit_start, commit_end, hp->mark_array))
+        if (!commit_mark_array_by_range (commit_start, commit_end, hp->mark_array, h_number))
         {
             return FALSE;
         }
@@ -25914,7 +26412,7 @@ BOOL gc_heap::commit_mark_array_new_seg (gc_heap* hp,
                                     hp->card_table, new_card_table,
                                     hp->mark_array, ma));
 
-            if (!commit_mark_array_by_range (commit_start, commit_end, ma))
+            if (!commit_mark_array_by_range (commit_start, commit_end, ma, h_number))
             {
                 return FALSE;
             }
@@ -25926,7 +26424,7 @@ BOOL gc_heap::commit_mark_array_new_seg (gc_heap* hp,
     return TRUE;
 }
 
-BOOL gc_heap::commit_mark_array_by_range (uint8_t* begin, uint8_t* end, uint32_t* mark_array_addr)
+BOOL gc_heap::commit_mark_array_by_range (uint8_t* begin, uint8_t* end, uint32_t* mark_array_addr, int h_number)
 {
     size_t beg_word = mark_word_of (begin);
     size_t end_word = mark_word_of (align_on_mark_word (end));
@@ -25948,6 +26446,8 @@ BOOL gc_heap::commit_mark_array_by_range (uint8_t* begin, uint8_t* end, uint32_t
 
     if (virtual_commit (commit_start, size, gc_oh_num::none))
     {
+        bind_to_heap_numa_node ((uint8_t*)&mark_array_addr[beg_word], (uint8_t*)&mark_array_addr[end_word], h_number);
+
         // We can only verify the mark array is cleared from begin to end, the first and the last
         // page aren't necessarily all cleared 'cause they could be used by other segments or
         // card bundle.
@@ -25969,9 +26469,11 @@ BOOL gc_heap::commit_mark_array_with_check (heap_segment* seg, uint32_t* new_mar
 #ifdef MULTIPLE_HEAPS
     uint8_t* lowest = heap_segment_heap (seg)->background_saved_lowest_address;
     uint8_t* highest = heap_segment_heap (seg)->background_saved_highest_address;
+    int h_number = (heap_segment_read_only_p (seg) ? -1 : heap_segment_heap (seg)->heap_number);
 #else
     uint8_t* lowest = background_saved_lowest_address;
     uint8_t* highest = background_saved_highest_address;
+    int h_number = -1;
 #endif //MULTIPLE_HEAPS
 
     if ((highest >= start) &&
@@ -25979,7 +26481,7 @@ BOOL gc_heap::commit_mark_array_with_check (heap_segment* seg, uint32_t* new_mar
     {
         start = max (lowest, start);
         end = min (highest, end);
-        if (!commit_mark_array_by_range (start, end, new_mark_array_addr))
+        if (!commit_mark_array_by_range (start, end, new_mark_array_addr, h_number))
         {
             return FALSE;
         }
@@ -25988,7 +26490,7 @@ BOOL gc_heap::commit_mark_array_with_check (heap_segment* seg, uint32_t* new_mar
     return TRUE;
 }
 
-BOOL gc_heap::commit_mark_array_by_seg (heap_segment* seg, uint32_t* mark_array_addr)
+BOOL gc_heap::commit_mark_array_by_seg (heap_segment* seg, uint32_t* mark_array_addr, int h_number)
 {
     dprintf (GC_TABLE_LOG, ("seg: %Ix->%Ix; MA: %Ix",
         seg,
@@ -25996,7 +26498,7 @@ BOOL gc_heap::commit_mark_array_by_seg (heap_segment* seg, uint32_t* mark_array_
         mark_array_addr));
     uint8_t* start = (heap_segment_read_only_p (seg) ? heap_segment_mem (seg) : (uint8_t*)seg);
 
-    return commit_mark_array_by_range (start, heap_segment_reserved (seg), mark_array_addr);
+    return commit_mark_array_by_range (start, heap_segment_reserved (seg), mark_array_addr, h_number);
 }
 
 BOOL gc_heap::commit_mark_array_bgc_init()
@@ -26049,7 +26551,7 @@ BOOL gc_heap::commit_mark_array_bgc_init()
                 {
                     // For normal segments they are by design completely in range so just 
                     // commit the whole mark array for each seg.
-                    if (commit_mark_array_by_seg (seg, mark_array))
+                    if (commit_mark_array_by_seg (seg, mark_array, heap_number))
                     {
                         if (seg->flags & heap_segment_flags_ma_pcommitted)
                         {
@@ -26481,6 +26983,7 @@ void gc_heap::background_mark_phase ()
 
             suspended_start_time = GetHighPrecisionTimeStamp();
             bgc_suspend_EE ();
+            record_suspension();
             //suspend_EE ();
             bgc_threads_sync_event.Set();
         }
@@ -29364,15 +29867,16 @@ bool card_marking_enumerator::move_next(heap_segment* seg, uint8_t*& low, uint8_
         uint8_t* start = heap_segment_mem(segment);
         uint8_t* end = compute_next_end(segment, gc_low);
 
-        uint8_t* aligned_start = (uint8_t*)((size_t)start & ~(CARD_MARKING_STEALING_GRANULARITY - 1));
+        size_t granularity = card_marking_stealing_granularity;
+        uint8_t* aligned_start = (uint8_t*)((size_t)start & ~(granularity - 1));
         size_t seg_size = end - aligned_start;
-        uint32_t chunk_count_within_seg = (uint32_t)((seg_size + (CARD_MARKING_STEALING_GRANULARITY - 1)) / CARD_MARKING_STEALING_GRANULARITY);
+        uint32_t chunk_count_within_seg = (uint32_t)((seg_size + (granularity - 1)) / granularity);
         if (chunk_index_within_seg < chunk_count_within_seg)
         {
             if (seg == segment)
             {
-                low = (chunk_index_within_seg == 0) ? start : (aligned_start + (size_t)chunk_index_within_seg * CARD_MARKING_STEALING_GRANULARITY);
-                high = (chunk_index_within_seg + 1 == chunk_count_within_seg) ? end : (aligned_start + (size_t)(chunk_index_within_seg + 1) * CARD_MARKING_STEALING_GRANULARITY);
+                low = (chunk_index_within_seg == 0) ? start : (aligned_start + (size_t)chunk_index_within_seg * granularity);
+                high = (chunk_index_within_seg + 1 == chunk_count_within_seg) ? end : (aligned_start + (size_t)(chunk_index_within_seg + 1) * granularity);
                 chunk_high = high;
                 return true;
             }
@@ -31912,7 +32416,7 @@ void gc_heap::decommit_ephemeral_segment_pages()
 #endif // HOST_64BIT
 
     uint8_t *decommit_target = heap_segment_allocated (ephemeral_heap_segment) + slack_space;
-    if (decommit_target < heap_segment_decommit_target (ephemeral_heap_segment))
+    if ((decommit_target < heap_segment_decommit_target (ephemeral_heap_segment)) && !g_low_memory_status)
     {
         // we used to have a higher target - do exponential smoothing by computing
         // essentially decommit_target = 1/3*decommit_target + 2/3*previous_decommit_target
@@ -31924,7 +32428,12 @@ void gc_heap::decommit_ephemeral_segment_pages()
     heap_segment_decommit_target(ephemeral_heap_segment) = decommit_target;
 
 #ifdef MULTIPLE_HEAPS
-    if (decommit_target < heap_segment_committed (ephemeral_heap_segment))
+    if (g_low_memory_status)
+    {
+        // Memory is low - give the space back now instead of decommitting it gradually.
+        decommit_heap_segment_pages (ephemeral_heap_segment, slack_space);
+    }
+    else if (decommit_target < heap_segment_committed (ephemeral_heap_segment))
     {
         gradual_decommit_in_progress_p = TRUE;
     }
@@ -31946,8 +32455,12 @@ void gc_heap::decommit_ephemeral_segment_pages()
 
     // we do a max of DECOMMIT_SIZE_PER_MILLISECOND per millisecond of elapsed time since the last GC
     // we limit the elapsed time to 10 seconds to avoid spending too much time decommitting
-    ptrdiff_t max_decommit_size = min (ephemeral_elapsed, (10*1000)) * DECOMMIT_SIZE_PER_MILLISECOND;
-    decommit_size = min (decommit_size, max_decommit_size);
+    // unless memory is low, in which case we decommit everything we don't need right away
+    if (!g_low_memory_status)
+    {
+        ptrdiff_t max_decommit_size = min (ephemeral_elapsed, (10*1000)) * DECOMMIT_SIZE_PER_MILLISECOND;
+        decommit_size = min (decommit_size, max_decommit_size);
+    }
 
     slack_space = heap_segment_committed (ephemeral_heap_segment) - heap_segment_allocated (ephemeral_heap_segment) - decommit_size;
     decommit_heap_segment_pages (ephemeral_heap_segment, slack_space);
@@ -31965,17 +32478,31 @@ bool gc_heap::decommit_step ()
     // will not do anything if use_large_pages_p is true
     assert (!use_large_pages_p);
 
+    // Under high memory load there's no point in holding on to memory we already
+    // decided we don't need - take larger steps to get to the decommit target sooner.
+    // The steps stay bounded so that a single step doesn't hold up the GC thread, and
+    // whoever is waiting on it, for a long series of decommit calls.
+    uint32_t memory_load = 0;
+    get_memory_info (&memory_load);
+    size_t step_size = max_decommit_step_size;
+    if (memory_load >= high_memory_load_th)
+    {
+        step_size *= HIGH_MEMORY_LOAD_DECOMMIT_STEP_FACTOR;
+    }
+
     size_t decommit_size = 0;
     for (int i = 0; i < n_heaps; i++)
     {
         gc_heap* hp = gc_heap::g_heaps[i];
-        decommit_size += hp->decommit_ephemeral_segment_pages_step ();
+        decommit_size += hp->decommit_ephemeral_segment_pages_step (step_size);
     }
+
+    dprintf (3, ("decommit step: ml %d, decommitted %Id", memory_load, decommit_size));
     return (decommit_size != 0);
 }
 
 // return the decommitted size
-size_t gc_heap::decommit_ephemeral_segment_pages_step ()
+size_t gc_heap::decommit_ephemeral_segment_pages_step (size_t step_size)
 {
     // we rely on desired allocation not being changed outside of GC
     assert (ephemeral_heap_segment->saved_desired_allocation == dd_desired_allocation (dynamic_data_of (0)));
@@ -31992,11 +32519,25 @@ size_t gc_heap::decommit_ephemeral_segment_pages_step ()
         // how much would we need to decommit to get to decommit_target in one step?
         size_t full_decommit_size = (committed - decommit_target);
 
-        // don't do more than max_decommit_step_size per step
-        size_t decommit_size = min (max_decommit_step_size, full_decommit_size);
+        // don't do more than step_size per step
+        size_t decommit_size = min (step_size, full_decommit_size);
 
         // figure out where the new committed should be
         uint8_t* new_committed = (committed - decommit_size);
+
+        if (transparent_huge_page_size != 0)
+        {
+            // The worker keeps the huge page new_committed falls into committed. With many heaps
+            // the step is smaller than a huge page, so once committed is on a huge page boundary
+            // every step would end up decommitting nothing. Step back to the huge page boundary
+            // below instead, as long as that doesn't go past the target.
+            uint8_t* huge_page_start = (uint8_t*)((size_t)new_committed & ~(transparent_huge_page_size - 1));
+            if (huge_page_start >= decommit_target)
+            {
+                new_committed = huge_page_start;
+            }
+        }
+
         size_t size = decommit_heap_segment_pages_worker (ephemeral_heap_segment, new_committed);
 
 #ifdef _DEBUG
@@ -33180,6 +33721,7 @@ void gc_heap::background_sweep()
         uint64_t suspended_end_ts = GetHighPrecisionTimeStamp();
         last_bgc_info[last_bgc_info_index].pause_durations[1] = (size_t)(suspended_end_ts - suspended_start_time);
         total_suspended_time += last_bgc_info[last_bgc_info_index].pause_durations[1];
+        record_pause (gc_pause_background, last_bgc_info[last_bgc_info_index].pause_durations[1]);
         restart_EE ();
     }
 
@@ -35398,6 +35940,12 @@ HRESULT GCHeap::Initialize()
     }
     gc_heap::min_segment_size_shr = index_of_highest_set_bit (gc_heap::min_segment_size);
 
+    // Large pages are committed up front, we never decommit them.
+    if (!gc_heap::use_large_pages_p)
+    {
+        gc_heap::transparent_huge_page_size = GCToOSInterface::GetTransparentHugePageSize();
+    }
+
 #ifdef MULTIPLE_HEAPS
     gc_heap::n_heaps = nhp;
     hr = gc_heap::initialize_gc (seg_size, large_seg_size /*loh_segment_size*/, pin_seg_size /*poh_segment_size*/, nhp);
@@ -36430,6 +36978,7 @@ void gc_heap::add_bgc_pause_duration_0()
         }
 
         total_suspended_time += last_gc_info->pause_durations[0];
+        record_pause (gc_pause_background, last_gc_info->pause_durations[0]);
     }
 }
 
@@ -36441,6 +36990,87 @@ last_recorded_gc_info* gc_heap::get_completed_bgc_info()
 }
 #endif //BACKGROUND_GC
 
+void gc_heap::record_pause (gc_pause_kind kind, uint64_t duration)
+{
+    gc_pause_histogram* histogram = &pause_histograms[kind];
+    histogram->buckets[gc_pause_histogram_bucket (duration)]++;
+    histogram->count++;
+    histogram->total_duration += duration;
+    if (duration > histogram->max_duration)
+    {
+        histogram->max_duration = duration;
+    }
+}
+
+void gc_heap::record_suspension()
+{
+    record_pause (gc_pause_suspension, GetHighPrecisionTimeStamp() - suspended_start_time);
+}
+
+C_ASSERT(GC_HISTORY_GENERATION_COUNT == total_generation_count);
+
+void gc_heap::record_history (gc_history_global* current_gc_data_global)
+{
+    if (history_size == 0)
+    {
+        return;
+    }
+
+    history_version++;
+    MemoryBarrier();
+
+#ifdef MULTIPLE_HEAPS
+    for (int heap_index = 0; heap_index < gc_heap::n_heaps; heap_index++)
+    {
+        gc_heap* hp = gc_heap::g_heaps[heap_index];
+#else
+    {
+        gc_heap* hp = pGenGCHeap;
+#endif //MULTIPLE_HEAPS
+        gc_history_per_heap* current_gc_data_per_heap = hp->get_gc_data_per_heap();
+        gc_history_record* record = &history_records[history_count % history_size];
+
+        record->gc_index = settings.gc_index;
+        record->heap_index = hp->heap_number;
+        record->heap_count = current_gc_data_global->num_heaps;
+        record->condemned_generation = current_gc_data_global->condemned_generation;
+        record->reason = (int32_t)current_gc_data_global->reason;
+        record->pause_mode = current_gc_data_global->pause_mode;
+        record->memory_load = current_gc_data_global->mem_pressure;
+        record->global_mechanisms = current_gc_data_global->global_mechanisms_p;
+        record->global_condemn_reasons_gen = current_gc_data_global->gen_to_condemn_reasons.get_reasons0();
+        record->global_condemn_reasons_condition = current_gc_data_global->gen_to_condemn_reasons.get_reasons1();
+        record->condemn_reasons_gen = current_gc_data_per_heap->gen_to_condemn_reasons.get_reasons0();
+        record->condemn_reasons_condition = current_gc_data_per_heap->gen_to_condemn_reasons.get_reasons1();
+        record->compact_reason = current_gc_data_per_heap->get_mechanism (gc_heap_compact);
+        record->expand_mechanism = current_gc_data_per_heap->get_mechanism (gc_heap_expand);
+        record->mechanism_bits = current_gc_data_per_heap->machanism_bits;
+        record->extra_gen0_committed = current_gc_data_per_heap->extra_gen0_committed;
+        record->remote_node_alloc_switches = current_gc_data_per_heap->remote_node_alloc_switches;
+        record->card_mark_time = current_gc_data_per_heap->card_mark_time;
+        record->card_mark_steal_time = current_gc_data_per_heap->card_mark_steal_time;
+
+        for (int gen_number = 0; gen_number < GC_HISTORY_GENERATION_COUNT; gen_number++)
+        {
+            gc_generation_data* gen_data = &current_gc_data_per_heap->gen_data[gen_number];
+            gc_history_generation* generation = &record->generations[gen_number];
+
+            generation->size_before = gen_data->size_before;
+            generation->size_after = gen_data->size_after;
+            generation->fragmentation_before = gen_data->free_list_space_before + gen_data->free_obj_space_before;
+            generation->fragmentation_after = gen_data->free_list_space_after + gen_data->free_obj_space_after;
+            generation->survived = gen_data->pinned_surv + gen_data->npinned_surv;
+            generation->pinned_survived = gen_data->pinned_surv;
+            generation->promoted_in = gen_data->in;
+        }
+
+        history_count++;
+    }
+
+    MemoryBarrier();
+    history_version++;
+}
+
 void gc_heap::do_pre_gc()
 {
     STRESS_LOG_GC_STACK;
@@ -36840,7 +37470,18 @@ void gc_heap::do_post_gc()
     gc_heap* hp = 0;
 #endif //MULTIPLE_HEAPS
 
-    GCToEEInterface::GcDone(settings.condemned_generation);
+#ifdef MULTIPLE_HEAPS
+#ifdef BACKGROUND_GC
+    if (settings.concurrent)
+    {
+        bgc_t_join.publish_stats (settings.gc_index);
+    }
+    else
+#endif //BACKGROUND_GC
+    {
+        gc_t_join.publish_stats (settings.gc_index);
+    }
+#endif //MULTIPLE_HEAPS
 
     GCToEEInterface::DiagGCEnd(VolatileLoad(&settings.gc_index),
                          (uint32_t)settings.condemned_generation,
@@ -36901,6 +37542,13 @@ void gc_heap::do_post_gc()
         (settings.promotion ? "P" : "S"),
         settings.entry_memory_load,
         current_memory_load));
+
+    {
+        uint64_t flush_count, flush_total_ns, flush_max_ns, flush_fallback_count;
+        GCToOSInterface::GetFlushProcessWriteBuffersStats (&flush_count, &flush_total_ns, &flush_max_ns, &flush_fallback_count);
+        dprintf (2, ("FlushProcessWriteBuffers: %I64d flushes, total %I64dns, max %I64dns, %I64d fallbacks",
+            flush_count, flush_total_ns, flush_max_ns, flush_fallback_count));
+    }
 #endif //SIMPLE_DPRINTF
 
     // Now record the gc info.
@@ -36920,6 +37568,14 @@ void gc_heap::do_post_gc()
     last_gc_info->total_committed = total_heap_committed;
     last_gc_info->promoted = get_total_promoted();
     last_gc_info->pinned_objects = get_total_pinned_objects();
+    get_total_pinned_plug_info (&(last_gc_info->pinned_plugs),
+                                &(last_gc_info->pinned_plug_size),
+                                &(last_gc_info->pinned_plug_fragmentation));
+    if (!settings.compaction)
+    {
+        // If we swept, the space in front of pinned plugs is just free space like any other gap.
+        last_gc_info->pinned_plug_fragmentation = 0;
+    }
     last_gc_info->finalize_promoted_objects = GCHeap::GetFinalizablePromotedCount();
 
     if (!settings.concurrent)
@@ -36938,6 +37594,7 @@ void gc_heap::do_post_gc()
         last_gc_info->pause_durations[0] = pause_duration;
         total_suspended_time += pause_duration;
         last_gc_info->pause_durations[1] = 0;
+        record_pause ((gc_pause_kind)(gc_pause_blocking_gen0 + settings.condemned_generation), pause_duration);
     }
 
     uint64_t total_process_time = end_gc_time - process_start_time;
@@ -36959,6 +37616,9 @@ void gc_heap::do_post_gc()
     is_last_recorded_bgc = settings.concurrent;
 #endif //BACKGROUND_GC
 
+    // After the info is recorded so that the EE can read this GC's info with GetMemoryInfo.
+    GCToEEInterface::GcDone(settings.condemned_generation);
+
 #ifdef TRACE_GC
     if (heap_hard_limit)
     {
@@ -37119,6 +37779,7 @@ GCHeap::GarbageCollectGeneration (unsigned int gen, gc_reason reason)
         BEGIN_TIMING(suspend_ee_during_log);
         GCToEEInterface::SuspendEE(SUSPEND_FOR_GC);
         END_TIMING(suspend_ee_during_log);
+        gc_heap::record_suspension();
         gc_heap::proceed_with_gc_p = gc_heap::should_proceed_with_gc();
         gc_heap::disable_preemptive (cooperative_mode);
         if (gc_heap::proceed_with_gc_p)
@@ -37389,6 +38050,9 @@ void GCHeap::GetMemoryInfo(uint64_t* highMemLoadThresholdBytes,
                            bool* isConcurrent,
                            uint64_t* genInfoRaw,
                            uint64_t* pauseInfoRaw,
+                           uint64_t* pinnedPlugCount,
+                           uint64_t* pinnedPlugSizeBytes,
+                           uint64_t* pinnedPlugFragmentationBytes,
                            int kind)
 {
     last_recorded_gc_info* last_gc_info = 0;
@@ -37431,6 +38095,9 @@ void GCHeap::GetMemoryInfo(uint64_t* highMemLoadThresholdBytes,
     *totalCommittedBytes = last_gc_info->total_committed;
     *promotedBytes = last_gc_info->promoted;
     *pinnedObjectCount = last_gc_info->pinned_objects;
+    *pinnedPlugCount = last_gc_info->pinned_plugs;
+    *pinnedPlugSizeBytes = last_gc_info->pinned_plug_size;
+    *pinnedPlugFragmentationBytes = last_gc_info->pinned_plug_fragmentation;
     *finalizationPendingCount = last_gc_info->finalize_promoted_objects;
     *index = last_gc_info->index;
     *generation = last_gc_info->condemned_generation;
@@ -37471,6 +38138,71 @@ void GCHeap::GetMemoryInfo(uint64_t* highMemLoadThresholdBytes,
 #endif //_DEBUG
 }
 
+void GCHeap::GetPauseHistogram(int kind, gc_pause_histogram* histogram)
+{
+    assert ((kind >= 0) && (kind < gc_pause_kind_count));
+    memcpy (histogram, &gc_heap::pause_histograms[kind], sizeof (gc_pause_histogram));
+}
+
+int GCHeap::GetJoinStats(int kind, gc_join_stats* stats, gc_join_heap_stats* heapStats, int heapStatsCount)
+{
+    assert ((kind >= 0) && (kind < gc_join_kind_count));
+
+#ifdef MULTIPLE_HEAPS
+#ifdef BACKGROUND_GC
+    if (kind == gc_join_kind_background)
+    {
+        return bgc_t_join.get_stats (stats, heapStats, heapStatsCount);
+    }
+#endif //BACKGROUND_GC
+    if (kind == gc_join_kind_server)
+    {
+        return gc_t_join.get_stats (stats, heapStats, heapStatsCount);
+    }
+#else
+    UNREFERENCED_PARAMETER(kind);
+    UNREFERENCED_PARAMETER(heapStats);
+    UNREFERENCED_PARAMETER(heapStatsCount);
+#endif //MULTIPLE_HEAPS
+
+    memset (stats, 0, sizeof (*stats));
+    return 0;
+}
+
+int GCHeap::GetHistory(gc_history_record* records, int count)
+{
+    if ((gc_heap::history_size == 0) || (count <= 0))
+    {
+        return 0;
+    }
+
+    // Retry while a GC is writing records. A background GC only writes them once at its end,
+    // so this won't take more than a few tries.
+    while (true)
+    {
+        uint32_t version = gc_heap::history_version;
+        if (version & 1)
+        {
+            GCToOSInterface::YieldThread (0);
+            continue;
+        }
+        MemoryBarrier();
+
+        uint64_t history_count = gc_heap::history_count;
+        uint64_t copy_count = min ((uint64_t)count, min (history_count, (uint64_t)gc_heap::history_size));
+        for (uint64_t i = 0; i < copy_count; i++)
+        {
+            records[i] = gc_heap::history_records[(history_count - copy_count + i) % gc_heap::history_size];
+        }
+
+        MemoryBarrier();
+        if (gc_heap::history_version == version)
+        {
+            return (int)copy_count;
+        }
+    }
+}
+
 uint32_t GCHeap::GetMemoryLoad()
 {
     uint32_t memory_load = 0;
@@ -60,6 +60,14 @@ public:
 // The value for BGCMLkp and BGCMLki will be divided by 1000.
 // The value for BGCFLkp and BGCFLki will be divided by 1000000.
 
+// Memory pressure notifications are only collected on by default where the OS support is
+// implemented, which is cgroup v2 on Linux.
+#if defined(__linux__)
+#define GC_MEMORY_PRESSURE_NOTIFICATION_DEFAULT true
+#else
+#define GC_MEMORY_PRESSURE_NOTIFICATION_DEFAULT false
+#endif
+
 // Each one of these keys produces a method on GCConfig with the name "Get{name}", where {name}
 // is the first parameter of the *_CONFIG macros below.
 #define GC_CONFIGURATION_KEYS \
@@ -77,6 +85,9 @@ public:
     BOOL_CONFIG  (GCNumaAware,            "GCNumaAware",            NULL,                             true,              "Enables numa allocations in the GC")                                                     \
     BOOL_CONFIG  (GCCpuGroup,             "GCCpuGroup",             NULL,                             false,             "Enables CPU groups in the GC")                                                           \
     BOOL_CONFIG  (GCLargePages,           "GCLargePages",           "System.GC.LargePages",           false,             "Enables using Large Pages in the GC")                                                    \
+    BOOL_CONFIG  (GCTHP,                  "GCTHP",                  "System.GC.TransparentHugePages", false,             "Asks the OS to back the GC heap with transparent huge pages (Linux only)")               \
+    BOOL_CONFIG  (GCMemoryPressureNotification, "GCMemoryPressureNotification", NULL,               GC_MEMORY_PRESSURE_NOTIFICATION_DEFAULT, "Collects when the OS reports memory pressure (cgroup v2 PSI or memory.high on Linux)")   \
+    BOOL_CONFIG  (GCPreciseCardMarking,   "GCPreciseCardMarking",   NULL,                             false,             "Makes the write barrier mark individual cards instead of whole card bytes, where supported") \
     INT_CONFIG   (HeapVerifyLevel,        "HeapVerify",             NULL,                             HEAPVERIFY_NONE,   "When set verifies the integrity of the managed heap on entry and exit of each GC")       \
     INT_CONFIG   (LOHCompactionMode,      "GCLOHCompact",           NULL,                             0,                 "Specifies the LOH compaction mode")                                                      \
     INT_CONFIG   (LOHThreshold,           "GCLOHThreshold",         NULL,                             LARGE_OBJECT_SIZE, "Specifies the size that will make objects go on LOH")                                    \
@@ -84,6 +95,7 @@ public:
     INT_CONFIG   (BGCSpin,                "BGCSpin",                NULL,                             2,                 "Specifies the bgc spin time")                                                            \
     INT_CONFIG   (HeapCount,              "GCHeapCount",            "System.GC.HeapCount",            0,                 "Specifies the number of server GC heaps")                                                \
     INT_CONFIG   (Gen0Size,               "GCgen0size",             NULL,                             0,                 "Specifies the smallest gen0 size")                                                       \
+    INT_CONFIG   (GCMemoryPressureStallMs, "GCMemoryPressureStallMs", NULL,                           100,               "Memory stall time within 2 seconds at which Linux PSI reports memory pressure")         \
     INT_CONFIG   (SegmentSize,            "GCSegmentSize",          NULL,                             0,                 "Specifies the managed heap segment size")                                                \
     INT_CONFIG   (LatencyMode,            "GCLatencyMode",          NULL,                             -1,                "Specifies the GC latency mode - batch, interactive or low latency (note that the same "  \
                                                                                                                          "thing can be specified via API which is the supported way")                              \
@@ -128,6 +140,15 @@ public:
     INT_CONFIG   (GCHeapHardLimitSOHPercent, "GCHeapHardLimitSOHPercent", NULL,                             0,                 "Specifies the GC heap SOH usage as a percentage of the total memory")              \
     INT_CONFIG   (GCHeapHardLimitLOHPercent, "GCHeapHardLimitLOHPercent", NULL,                             0,                 "Specifies the GC heap LOH usage as a percentage of the total memory")              \
     INT_CONFIG   (GCHeapHardLimitPOHPercent, "GCHeapHardLimitPOHPercent", NULL,                             0,                 "Specifies the GC heap POH usage as a percentage of the total memory")              \
+    INT_CONFIG   (GCCardMarkingStealingGranularity, "GCCardMarkingStealingGranularity", NULL,        0,                 "Specifies the size in bytes of the card table chunks server GC threads can steal "  \
+                                                                                                                         "from each other when marking through cards (rounded to a power of 2)")              \
+    INT_CONFIG   (GCFragCompactMaxGen2Size, "GCFragCompactMaxGen2Size", NULL,                        0,                 "Specifies the gen2 live size (in bytes, over all heaps) above which high gen2 "       \
+                                                                                                                         "fragmentation alone no longer causes a blocking compacting gen2 GC when background "    \
+                                                                                                                         "GC is enabled and memory load is not high")                                             \
+    INT_CONFIG   (GCFragCompactCeilingPercent, "GCFragCompactCeilingPercent", NULL,                  50,                "Specifies the percentage of a heap's gen2 that is free space above which high "       \
+                                                                                                                         "fragmentation causes a blocking compacting gen2 GC even when the heap's share of "     \
+                                                                                                                         "GCFragCompactMaxGen2Size is exceeded")                                                  \
+    INT_CONFIG   (GCHistorySize,          "GCHistorySize",          NULL,                             256,               "Specifies the number of per heap GC history records kept for GetHistory, 0 disables it") \
 
 // This class is responsible for retreiving configuration information
 // for how the GC should operate.
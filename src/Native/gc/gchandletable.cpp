@@ -4,6 +4,7 @@
 
 #include "common.h"
 #include "gcenv.h"
+#include "gc.h"
 #include "gchandletableimpl.h"
 #include "objecthandle.h"
 #include "handletablepriv.h"
@@ -176,3 +177,8 @@ void GCHandleManager::TraceRefCountedHandles(HANDLESCANPROC callback, uintptr_t
     ::Ref_TraceRefCountHandles(callback, param1, param2);
 }
 
+uint32_t GCHandleManager::CountHandles()
+{
+    return ::HndCountAllHandles(!IsGCInProgress());
+}
+
@@ -67,6 +67,8 @@ public:
     virtual HandleType HandleFetchType(OBJECTHANDLE handle);
 
     virtual void TraceRefCountedHandles(HANDLESCANPROC callback, uintptr_t param1, uintptr_t param2);
+
+    virtual uint32_t CountHandles();
 };
 
 #endif  // GCHANDLETABLE_H_
@@ -180,8 +180,17 @@ public:
                        bool* isConcurrent,
                        uint64_t* genInfoRaw,
                        uint64_t* pauseInfoRaw,
+                       uint64_t* pinnedPlugCount,
+                       uint64_t* pinnedPlugSizeBytes,
+                       uint64_t* pinnedPlugFragmentationBytes,
                        int kind);;
 
+    void GetPauseHistogram(int kind, gc_pause_histogram* histogram);
+
+    int GetHistory(gc_history_record* records, int count);
+
+    int GetJoinStats(int kind, gc_join_stats* stats, gc_join_heap_stats* heapStats, int heapStatsCount);
+
     uint32_t GetMemoryLoad();
 
     int GetGcLatencyMode();
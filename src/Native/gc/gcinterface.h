@@ -6,12 +6,12 @@
 
 // The major version of the GC/EE interface. Breaking changes to this interface
 // require bumps in the major version number.
-#define GC_INTERFACE_MAJOR_VERSION 4
+#define GC_INTERFACE_MAJOR_VERSION 11
 
 // The minor version of the GC/EE interface. Non-breaking changes are required
 // to bump the minor version number. GCs and EEs with minor version number
 // mismatches can still interopate correctly, with some care.
-#define GC_INTERFACE_MINOR_VERSION 1
+#define GC_INTERFACE_MINOR_VERSION 2
 
 struct ScanContext;
 struct gc_alloc_context;
@@ -108,6 +108,12 @@ struct WriteBarrierParameters
     // The new write watch table, if we are using our own write watch
     // implementation. Used for WriteBarrierOp::SwitchToWriteWatch only.
     uint8_t* write_watch_table;
+
+    // Whether the write barrier should set only the bit of the card covering
+    // the updated location instead of the whole card byte. The GC scans cards
+    // at bit granularity either way, so this only trades a more expensive
+    // barrier for fewer cards to scan. Used for WriteBarrierOp::Initialize.
+    bool precise_card_marking;
 };
 
 // Opaque type for tracking object pointers
@@ -304,6 +310,140 @@ enum gc_kind
     gc_kind_background = 3     // background GC (always gen2)
 };
 
+// The kinds of pauses the GC keeps a gc_pause_histogram for.
+enum gc_pause_kind
+{
+    gc_pause_blocking_gen0 = 0, // whole pause of a blocking gen0 GC, including suspension
+    gc_pause_blocking_gen1 = 1, // whole pause of a blocking gen1 GC, including suspension
+    gc_pause_blocking_gen2 = 2, // whole pause of a blocking gen2 GC, including suspension
+    gc_pause_background = 3,    // each of the two pauses of a background GC
+    gc_pause_suspension = 4,    // time it took to suspend the runtime for a GC
+    gc_pause_mark = 5,          // mark phase of a blocking GC
+    gc_pause_plan = 6,          // plan phase of a blocking GC, excluding relocate and compact
+    gc_pause_relocate = 7,      // relocate phase of a compacting GC
+    gc_pause_compact = 8,       // compact phase of a compacting GC
+    gc_pause_kind_count = 9
+};
+
+// Durations in a gc_pause_histogram are in microseconds. Durations below 2 * GC_PAUSE_HISTOGRAM_SUB_BUCKETS
+// each have their own bucket. Above that, every power of 2 range is split into GC_PAUSE_HISTOGRAM_SUB_BUCKETS
+// buckets of equal width, so a duration is never off by more than 1/16th of its value. Durations of
+// 2^GC_PAUSE_HISTOGRAM_MAX_BITS microseconds (over an hour) or more all go in the last bucket.
+#define GC_PAUSE_HISTOGRAM_SUB_BUCKET_BITS 4
+#define GC_PAUSE_HISTOGRAM_SUB_BUCKETS (1 << GC_PAUSE_HISTOGRAM_SUB_BUCKET_BITS)
+#define GC_PAUSE_HISTOGRAM_MAX_BITS 32
+#define GC_PAUSE_HISTOGRAM_BUCKETS ((GC_PAUSE_HISTOGRAM_MAX_BITS - GC_PAUSE_HISTOGRAM_SUB_BUCKET_BITS + 1) * GC_PAUSE_HISTOGRAM_SUB_BUCKETS)
+
+struct gc_pause_histogram
+{
+    uint64_t count;
+    uint64_t total_duration;
+    uint64_t max_duration;
+    uint32_t buckets[GC_PAUSE_HISTOGRAM_BUCKETS];
+};
+
+inline uint32_t gc_pause_histogram_bucket(uint64_t duration)
+{
+    const uint64_t max_duration = ((uint64_t)1 << GC_PAUSE_HISTOGRAM_MAX_BITS) - 1;
+    if (duration > max_duration)
+        duration = max_duration;
+
+    uint32_t shift = 0;
+    while ((duration >> shift) >= 2 * GC_PAUSE_HISTOGRAM_SUB_BUCKETS)
+        shift++;
+
+    return shift * GC_PAUSE_HISTOGRAM_SUB_BUCKETS + (uint32_t)(duration >> shift);
+}
+
+// Returns the largest duration that goes in the given bucket.
+inline uint64_t gc_pause_histogram_bucket_limit(uint32_t bucket)
+{
+    if (bucket < 2 * GC_PAUSE_HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+
+    uint32_t shift = bucket / GC_PAUSE_HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub_bucket = bucket % GC_PAUSE_HISTOGRAM_SUB_BUCKETS + GC_PAUSE_HISTOGRAM_SUB_BUCKETS;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+// Number of generations described by a gc_history_record: gen0, gen1, gen2, LOH and POH.
+#define GC_HISTORY_GENERATION_COUNT 5
+
+struct gc_history_generation
+{
+    uint64_t size_before;           // including fragmentation
+    uint64_t size_after;            // including fragmentation
+    uint64_t fragmentation_before;  // free list and free object space
+    uint64_t fragmentation_after;
+    uint64_t survived;              // bytes that survived, pinned or not
+    uint64_t pinned_survived;
+    uint64_t promoted_in;           // bytes promoted into this generation
+};
+
+// What the GC decided, and why, for one heap in one GC. This is the data of the GCGlobalHeapHistory and
+// GCPerHeapHistory events. The reason and mechanism values are the ones of gcrecord.h.
+struct gc_history_record
+{
+    uint64_t gc_index;
+    uint32_t heap_index;
+    uint32_t heap_count;
+    int32_t condemned_generation;
+    int32_t reason;                     // gc_reason
+    int32_t pause_mode;
+    uint32_t memory_load;               // memory load when the GC started, in percent
+    uint32_t global_mechanisms;         // bit set of gc_global_mechanism_p (concurrent, compaction, demotion...)
+    uint32_t global_condemn_reasons_gen;        // generation chosen at each gc_condemn_reason_gen, 2 bits each
+    uint32_t global_condemn_reasons_condition;  // bit set of gc_condemn_reason_condition
+    uint32_t condemn_reasons_gen;       // the same for this heap
+    uint32_t condemn_reasons_condition;
+    int32_t compact_reason;             // gc_heap_compact_reason, or -1 if the heap was not compacted
+    int32_t expand_mechanism;           // gc_heap_expand_mechanism, or -1 if the heap was not expanded
+    uint32_t mechanism_bits;            // bit set of gc_mechanism_bit_per_heap (mark list, demotion)
+    uint64_t extra_gen0_committed;
+    uint64_t remote_node_alloc_switches;    // allocation contexts balanced onto this heap from another NUMA node since the previous GC
+    uint64_t card_mark_time;            // microseconds this heap's GC thread spent marking through cards, 0 if it didn't
+    uint64_t card_mark_steal_time;      // part of card_mark_time spent marking through the cards of other heaps
+    gc_history_generation generations[GC_HISTORY_GENERATION_COUNT];
+};
+
+// The join points server GC threads synchronize at, of the GC itself or of the background GC threads.
+enum gc_join_kind
+{
+    gc_join_kind_server = 0,        // joins of blocking GCs, and of the part of a background GC done while suspended
+    gc_join_kind_background = 1,    // joins of the background GC threads
+    gc_join_kind_count = 2
+};
+
+// Larger than the number of join points (gc_join_stage in gc.cpp), so that new ones don't change the layout.
+#define GC_JOIN_STATS_MAX_STAGES 64
+
+// Times are in microseconds.
+struct gc_join_stage_stats
+{
+    uint32_t join_count;    // number of times all the heaps joined at this point
+    uint32_t spin_count;    // waits that ended while the heap was spinning
+    uint32_t block_count;   // waits that had to block on the join event
+    int32_t last_heap;      // heap that arrived last the most recent time, -1 if the point was not reached
+    uint64_t wait_time;     // total time heaps spent waiting for the other heaps at this point
+    uint64_t serial_time;   // total time between the last heap arriving and the heaps being restarted
+};
+
+struct gc_join_heap_stats
+{
+    uint32_t last_arrival_count;    // number of joins this heap was the last to arrive at
+    uint32_t reserved;
+    uint64_t wait_time;             // total time this heap spent waiting for the other heaps
+};
+
+// The join statistics of one GC, indexed by gc_join_stage.
+struct gc_join_stats
+{
+    uint64_t gc_index;      // index of the GC the statistics are for, 0 if there is none yet
+    uint32_t heap_count;
+    uint32_t stage_count;   // number of valid entries in stages
+    gc_join_stage_stats stages[GC_JOIN_STATS_MAX_STAGES];
+};
+
 typedef enum
 {
     /*
@@ -517,6 +657,10 @@ public:
     virtual HandleType HandleFetchType(OBJECTHANDLE handle) = 0;
 
     virtual void TraceRefCountedHandles(HANDLESCANPROC callback, uintptr_t param1, uintptr_t param2) = 0;
+
+    // Returns the number of handles in use in all handle stores. The handle tables are only locked
+    // while counting when no GC is in progress.
+    virtual uint32_t CountHandles() = 0;
 };
 
 // IGCHeap is the interface that the VM will use when interacting with the GC.
@@ -615,6 +759,9 @@ public:
     // isConcurrent - concurrent or not.
     // genInfoRaw - info about each generation.
     // pauseInfoRaw - pause info.
+    // pinnedPlugCount - # of pinned plugs observed.
+    // pinnedPlugSizeBytes - total size of the pinned plugs.
+    // pinnedPlugFragmentationBytes - free space left in front of pinned plugs if the GC compacted.
     virtual void GetMemoryInfo(uint64_t* highMemLoadThresholdBytes,
                                uint64_t* totalAvailableMemoryBytes,
                                uint64_t* lastRecordedMemLoadBytes,
@@ -631,8 +778,25 @@ public:
                                bool* isConcurrent,
                                uint64_t* genInfoRaw,
                                uint64_t* pauseInfoRaw,
+                               uint64_t* pinnedPlugCount,
+                               uint64_t* pinnedPlugSizeBytes,
+                               uint64_t* pinnedPlugFragmentationBytes,
                                int kind) = 0;
 
+    // Copies the histogram the GC keeps for the given gc_pause_kind. The histograms cover every GC
+    // since the process started and are updated while the runtime is suspended, so a copy taken while
+    // a GC is in progress may be a little inconsistent.
+    virtual void GetPauseHistogram(int kind, gc_pause_histogram* histogram) = 0;
+
+    // Copies up to count of the most recent gc_history_records, oldest first, and returns the number
+    // copied. The GC keeps the last GCHistorySize records, one per heap per GC.
+    virtual int GetHistory(gc_history_record* records, int count) = 0;
+
+    // Copies the join statistics of the last GC of the given gc_join_kind to stats, and the per heap ones to
+    // heapStats, which has room for heapStatsCount heaps. Returns the number of heaps, 0 for workstation GC.
+    // The statistics of a GC are published when it ends, so a copy taken then may be a little inconsistent.
+    virtual int GetJoinStats(int kind, gc_join_stats* stats, gc_join_heap_stats* heapStats, int heapStatsCount) = 0;
+
     // Get the last memory load in percentage observed by the last GC.
     virtual uint32_t GetMemoryLoad() = 0;
 
@@ -310,6 +310,18 @@ class sorted_table;
 class seg_free_spaces;
 class gc_heap;
 
+#if defined(FEATURE_LOH_COMPACTION) && defined(MULTIPLE_HEAPS)
+// A range of a heap's LOH, recorded by plan_loh, that the server GC threads
+// can relocate references in independently of the other ranges. It starts
+// at an object and ends at the start of the next range in the same segment,
+// or at the end of the segment.
+struct loh_reloc_unit
+{
+    heap_segment* seg;
+    uint8_t* start;
+};
+#endif //FEATURE_LOH_COMPACTION && MULTIPLE_HEAPS
+
 #ifdef BACKGROUND_GC
 class exclusive_sync;
 class recursive_gc_sync;
@@ -826,6 +838,9 @@ struct last_recorded_gc_info
     size_t total_committed;
     size_t promoted;
     size_t pinned_objects;
+    size_t pinned_plugs;
+    size_t pinned_plug_size;
+    size_t pinned_plug_fragmentation;
     size_t finalize_promoted_objects;
     size_t pause_durations[2];
     float pause_percentage;
@@ -1179,6 +1194,14 @@ public:
                                      gc_oh_num oh,
                                      int h_number);
 
+    // Binds the whole pages of the range to the NUMA node of the heap.
+    static
+    void bind_to_heap_numa_node (uint8_t* begin, uint8_t* end, int h_number);
+
+    // Binds the parts of the card table and brick table that cover the range to the NUMA node of the heap.
+    static
+    void bind_tables_to_heap_numa_node (uint8_t* start, uint8_t* end, int h_number);
+
     static
     gc_heap* make_gc_heap(
 #if defined (MULTIPLE_HEAPS)
@@ -1712,7 +1735,7 @@ protected:
     PER_HEAP
     void decommit_heap_segment_pages (heap_segment* seg, size_t extra_space);
     PER_HEAP
-    size_t decommit_ephemeral_segment_pages_step ();
+    size_t decommit_ephemeral_segment_pages_step (size_t step_size);
     PER_HEAP
     size_t decommit_heap_segment_pages_worker (heap_segment* seg, uint8_t *new_committed);
     PER_HEAP_ISOLATED
@@ -2399,6 +2422,9 @@ protected:
     PER_HEAP_ISOLATED
     size_t get_total_pinned_objects();
 
+    PER_HEAP_ISOLATED
+    void get_total_pinned_plug_info (size_t* plug_count, size_t* plug_size, size_t* plug_fragmentation);
+
     PER_HEAP
     void reset_mark_stack ();
     PER_HEAP
@@ -2473,6 +2499,17 @@ protected:
     PER_HEAP
     void relocate_in_loh_compact();
 
+    PER_HEAP
+    void relocate_in_loh_compact_range (uint8_t* o, uint8_t* end);
+
+#ifdef MULTIPLE_HEAPS
+    PER_HEAP
+    BOOL reserve_loh_reloc_units();
+
+    PER_HEAP
+    void relocate_in_loh_compact_units();
+#endif //MULTIPLE_HEAPS
+
     PER_HEAP
     void walk_relocation_for_loh (void* profiling_context, record_surv_fn fn);
 
@@ -2986,7 +3023,8 @@ protected:
     PER_HEAP_ISOLATED
     BOOL commit_mark_array_by_range (uint8_t* begin,
                                      uint8_t* end,
-                                     uint32_t* mark_array_addr);
+                                     uint32_t* mark_array_addr,
+                                     int h_number=-1);
 
     PER_HEAP_ISOLATED
     BOOL commit_mark_array_new_seg (gc_heap* hp,
@@ -3002,7 +3040,7 @@ protected:
     // seg and heap_segment_reserved (seg) are guaranteed to be
     // page aligned.
     PER_HEAP_ISOLATED
-    BOOL commit_mark_array_by_seg (heap_segment* seg, uint32_t* mark_array_addr);
+    BOOL commit_mark_array_by_seg (heap_segment* seg, uint32_t* mark_array_addr, int h_number=-1);
 
     // During BGC init, we commit the mark array for all in range
     // segments whose mark array hasn't been committed or fully
@@ -3390,6 +3428,42 @@ public:
     last_recorded_gc_info* get_completed_bgc_info();
 #endif //BACKGROUND_GC
 
+    // Histograms of pause durations, see gc_pause_kind. They are only updated
+    // while the runtime is suspended by the GC, and the phases are timed by
+    // heap 0 only, so no synchronization is needed.
+    PER_HEAP_ISOLATED
+    gc_pause_histogram pause_histograms[gc_pause_kind_count];
+
+    // Time spent in the relocate and compact phases of the current GC, which
+    // is taken out of the plan phase time since plan_phase calls them.
+    PER_HEAP_ISOLATED
+    uint64_t relocate_compact_duration;
+
+    PER_HEAP_ISOLATED
+    void record_pause (gc_pause_kind kind, uint64_t duration);
+
+    PER_HEAP_ISOLATED
+    void record_suspension();
+
+    // Ring of the last history_size gc_history_records, see GCHeap::GetHistory. Records are
+    // written by fire_pevents, which runs concurrently with the rest of the runtime at the end
+    // of a background GC, so readers use history_version like a sequence lock: it is odd while
+    // records are being written.
+    PER_HEAP_ISOLATED
+    gc_history_record* history_records;
+
+    PER_HEAP_ISOLATED
+    size_t history_size;
+
+    PER_HEAP_ISOLATED
+    uint64_t history_count;
+
+    PER_HEAP_ISOLATED
+    VOLATILE(uint32_t) history_version;
+
+    PER_HEAP_ISOLATED
+    void record_history (gc_history_global* current_gc_data_global);
+
 #ifdef HOST_64BIT
     PER_HEAP_ISOLATED
         size_t youngest_gen_desired_th;
@@ -3499,6 +3573,11 @@ public:
     PER_HEAP_ISOLATED
     bool use_large_pages_p;
 
+    // If the OS backs the heap with transparent huge pages, this is their size and
+    // we only decommit whole huge pages at the end of a segment. 0 otherwise.
+    PER_HEAP_ISOLATED
+    size_t transparent_huge_page_size;
+
 #ifdef HEAP_BALANCE_INSTRUMENTATION
     PER_HEAP_ISOLATED
     size_t last_gc_end_time_us;
@@ -3542,6 +3621,11 @@ protected:
     int heap_number;
     PER_HEAP
     VOLATILE(int) alloc_context_count;
+
+    // # of times balance_heaps moved an allocation context to this heap from a heap
+    // on another NUMA node since the last GC.
+    PER_HEAP
+    VOLATILE(int32_t) remote_node_alloc_switches;
 #else //MULTIPLE_HEAPS
 #define vm_heap ((GCHeap*) g_theGCHeap)
 #define heap_number (0)
@@ -3579,6 +3663,17 @@ protected:
     PER_HEAP
     size_t      num_pinned_objects;
 
+    // Pinned plug stats for the current GC - the number of pinned plugs planned,
+    // their total size and, if we compact, the free space left in front of them.
+    PER_HEAP
+    size_t      num_pinned_plugs;
+
+    PER_HEAP
+    size_t      pinned_plug_size;
+
+    PER_HEAP
+    size_t      pinned_plug_fragmentation;
+
 #ifdef FEATURE_LOH_COMPACTION
     PER_HEAP
     size_t      loh_pinned_queue_tos;
@@ -3609,6 +3704,24 @@ protected:
     // settings.loh_compaction is TRUE this may not be TRUE.
     PER_HEAP
     BOOL        loh_compacted_p;
+
+#ifdef MULTIPLE_HEAPS
+    // The ranges plan_loh split this heap's LOH into, so that heaps that are
+    // done with their own relocation can help with this heap's LOH. 0 ranges
+    // means they couldn't be recorded and this heap relocates its LOH alone.
+    PER_HEAP
+    loh_reloc_unit* loh_reloc_units;
+
+    PER_HEAP
+    size_t      loh_reloc_units_length;
+
+    PER_HEAP
+    size_t      loh_reloc_unit_count;
+
+    // Index of the last range claimed for relocation on this heap.
+    PER_HEAP
+    VOLATILE(uint32_t) loh_reloc_unit_index;
+#endif //MULTIPLE_HEAPS
 #endif //FEATURE_LOH_COMPACTION
 
 #ifdef BACKGROUND_GC
@@ -5001,7 +5114,10 @@ size_t gcard_of (uint8_t* object)
 }
 #ifdef FEATURE_CARD_MARKING_STEALING
 // make this 8 card bundle bits (2 MB in 64-bit architectures, 1 MB in 32-bit) - should be at least 1 card bundle bit
+// this is the default, the granularity actually used is card_marking_stealing_granularity which can be
+// changed via the GCCardMarkingStealingGranularity config
 #define CARD_MARKING_STEALING_GRANULARITY (card_size*card_word_width*card_bundle_size*8)
+#define MIN_CARD_MARKING_STEALING_GRANULARITY (card_size*card_word_width*card_bundle_size)
 
 #define THIS_ARG    , __this
 class card_marking_enumerator
@@ -357,6 +357,15 @@ public:
 
     size_t extra_gen0_committed;
 
+    // time (in us) this heap's GC thread spent marking through cards,
+    // and how much of that was spent helping other heaps.
+    size_t card_mark_time;
+    size_t card_mark_steal_time;
+
+    // # of allocation contexts balanced onto this heap from a heap on another NUMA
+    // node since the previous GC.
+    size_t remote_node_alloc_switches;
+
     void set_mechanism (gc_mechanism_per_heap mechanism_per_heap, uint32_t value);
 
     void set_mechanism_bit (gc_mechanism_bit_per_heap mech_bit)
@@ -29,6 +29,9 @@ Abstract:
 #include <sys/vfs.h>
 #endif
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
 #include <limits>
 
 #include "cgroup.h"
@@ -49,10 +52,16 @@ Abstract:
 #define CGROUP2_MEMORY_LIMIT_FILENAME "/memory.max"
 #define CGROUP1_MEMORY_USAGE_FILENAME "/memory.usage_in_bytes"
 #define CGROUP2_MEMORY_USAGE_FILENAME "/memory.current"
+#define CGROUP2_MEMORY_HIGH_FILENAME "/memory.high"
+#define CGROUP2_MEMORY_EVENTS_FILENAME "/memory.events"
+#define CGROUP2_MEMORY_PRESSURE_FILENAME "/memory.pressure"
 #define CGROUP1_CFS_QUOTA_FILENAME "/cpu.cfs_quota_us"
 #define CGROUP1_CFS_PERIOD_FILENAME "/cpu.cfs_period_us"
 #define CGROUP2_CPU_MAX_FILENAME "/cpu.max"
 
+// The PSI window we ask for. Unprivileged processes can only use multiples of 2 seconds.
+#define PSI_WINDOW_US 2000000
+
 extern bool ReadMemoryValueFromFile(const char* filename, uint64_t* val);
 
 class CGroup
@@ -62,6 +71,13 @@ class CGroup
 
     static char *s_memory_cgroup_path;
     static char *s_cpu_cgroup_path;
+
+    // the file we poll for memory pressure notifications or -1 if we don't have one
+    static int s_memory_pressure_fd;
+    // whether s_memory_pressure_fd is a PSI trigger (otherwise it's memory.events)
+    static bool s_memory_pressure_is_psi;
+    // the number of times the cgroup went over its limits the last time we read memory.events
+    static uint64_t s_memory_events_count;
 public:
     static void Initialize()
     {
@@ -72,6 +88,12 @@ public:
 
     static void Cleanup()
     {
+        if (s_memory_pressure_fd != -1)
+        {
+            close(s_memory_pressure_fd);
+            s_memory_pressure_fd = -1;
+        }
+
         free(s_memory_cgroup_path);
         free(s_cpu_cgroup_path);
     }
@@ -121,7 +143,164 @@ public:
         }
     }
 
+    // Set up a file we can poll for memory pressure on the process's cgroup. This is only
+    // supported with cgroup v2. We prefer a PSI trigger on memory.pressure, which fires when
+    // tasks in the cgroup were stalled on memory for at least stallUs within a 2 second window.
+    // Without PSI we fall back to memory.events, which changes whenever the cgroup goes over
+    // memory.high or hits memory.max.
+    static bool InitializeMemoryPressureNotification(uint32_t stallUs)
+    {
+        if ((s_cgroup_version != 2) || (s_memory_cgroup_path == nullptr))
+            return false;
+
+        assert(s_memory_pressure_fd == -1);
+
+        char* filename = nullptr;
+        if (asprintf(&filename, "%s%s", s_memory_cgroup_path, CGROUP2_MEMORY_PRESSURE_FILENAME) >= 0)
+        {
+            int fd = open(filename, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+            free(filename);
+
+            if (fd != -1)
+            {
+                // The kernel rejects thresholds that are 0 or longer than the window.
+                if (stallUs == 0)
+                    stallUs = 1;
+                else if (stallUs > PSI_WINDOW_US)
+                    stallUs = PSI_WINDOW_US;
+
+                // The trigger has to be written in one go, including the terminating nul.
+                char trigger[64];
+                int len = snprintf(trigger, sizeof(trigger), "some %u %u", stallUs, PSI_WINDOW_US);
+                if (write(fd, trigger, len + 1) >= 0)
+                {
+                    s_memory_pressure_fd = fd;
+                    s_memory_pressure_is_psi = true;
+                    return true;
+                }
+
+                close(fd);
+            }
+        }
+
+        // Without a limit memory.events will never report anything we care about.
+        uint64_t limit;
+        if (!GetCGroupMemoryLimit(&limit, CGROUP2_MEMORY_HIGH_FILENAME) &&
+            !GetCGroupMemoryLimit(&limit, CGROUP2_MEMORY_LIMIT_FILENAME))
+            return false;
+
+        if (asprintf(&filename, "%s%s", s_memory_cgroup_path, CGROUP2_MEMORY_EVENTS_FILENAME) < 0)
+            return false;
+
+        int fd = open(filename, O_RDONLY | O_CLOEXEC);
+        free(filename);
+        if (fd == -1)
+            return false;
+
+        // Reading the file also tells the kernel which change we've seen last.
+        s_memory_pressure_fd = fd;
+        s_memory_pressure_is_psi = false;
+        if (!ReadMemoryEventsCount(&s_memory_events_count))
+        {
+            close(fd);
+            s_memory_pressure_fd = -1;
+            return false;
+        }
+
+        return true;
+    }
+
+    // Wait for the kernel to report memory pressure on the process's cgroup. Only one thread
+    // may wait at a time.
+    // Return:
+    //  1 if memory pressure was reported, 0 if the wait timed out and -1 if it failed
+    static int WaitForMemoryPressureNotification(int timeoutMs)
+    {
+        if (s_memory_pressure_fd == -1)
+            return -1;
+
+        // Interruptions and memory.events changes we don't report must not extend the wait, so
+        // each poll only gets what is left until the deadline.
+        uint64_t deadlineMs = 0;
+        if (timeoutMs >= 0)
+            deadlineMs = GetMonotonicTimeMs() + timeoutMs;
+
+        while (true)
+        {
+            int remainingMs = -1;
+            if (timeoutMs >= 0)
+            {
+                uint64_t nowMs = GetMonotonicTimeMs();
+                remainingMs = (nowMs < deadlineMs) ? (int)(deadlineMs - nowMs) : 0;
+            }
+
+            struct pollfd pfd;
+            pfd.fd = s_memory_pressure_fd;
+            pfd.events = POLLPRI;
+            pfd.revents = 0;
+
+            int result = poll(&pfd, 1, remainingMs);
+            if (result == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+
+            if (result == 0)
+                return 0;
+
+            if (s_memory_pressure_is_psi)
+            {
+                // Without POLLPRI the trigger is gone, e.g. because the cgroup was removed.
+                return ((pfd.revents & POLLPRI) != 0) ? 1 : -1;
+            }
+
+            // memory.events has changed. Only report it if the cgroup went over a limit and not
+            // when some other counter changed.
+            uint64_t count;
+            if (!ReadMemoryEventsCount(&count))
+                return -1;
+
+            bool wentOverLimit = (count != s_memory_events_count);
+            s_memory_events_count = count;
+            if (wentOverLimit)
+                return 1;
+        }
+    }
+
 private:
+    static uint64_t GetMonotonicTimeMs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+    }
+
+    // Sum up the "high" and "max" counters in memory.events.
+    static bool ReadMemoryEventsCount(uint64_t *count)
+    {
+        char buffer[512];
+        ssize_t bytesRead = pread(s_memory_pressure_fd, buffer, sizeof(buffer) - 1, 0);
+        if (bytesRead <= 0)
+            return false;
+        buffer[bytesRead] = '\0';
+
+        uint64_t total = 0;
+        char* context = nullptr;
+        for (char* line = strtok_r(buffer, "\n", &context); line != nullptr; line = strtok_r(nullptr, "\n", &context))
+        {
+            unsigned long long value;
+            if ((sscanf(line, "high %llu", &value) == 1) || (sscanf(line, "max %llu", &value) == 1))
+            {
+                total += value;
+            }
+        }
+
+        *count = total;
+        return true;
+    }
+
     static int FindCGroupVersion()
     {
         // It is possible to have both cgroup v1 and v2 enabled on a system.
@@ -577,6 +756,9 @@ private:
 int CGroup::s_cgroup_version = 0;
 char *CGroup::s_memory_cgroup_path = nullptr;
 char *CGroup::s_cpu_cgroup_path = nullptr;
+int CGroup::s_memory_pressure_fd = -1;
+bool CGroup::s_memory_pressure_is_psi = false;
+uint64_t CGroup::s_memory_events_count = 0;
 
 void InitializeCGroup()
 {
@@ -684,3 +866,13 @@ bool GetCpuLimit(uint32_t* val)
 
     return CGroup::GetCpuLimit(val);
 }
+
+bool InitializeMemoryPressureNotification(uint32_t stallUs)
+{
+    return CGroup::InitializeMemoryPressureNotification(stallUs);
+}
+
+int WaitForMemoryPressureNotification(int timeoutMs)
+{
+    return CGroup::WaitForMemoryPressureNotification(timeoutMs);
+}
@@ -46,6 +46,9 @@ check_cxx_source_compiles("
     }
     " HAVE_MAP_HUGETLB)
 
+check_cxx_symbol_exists(MADV_FREE sys/mman.h HAVE_MADV_FREE)
+check_cxx_symbol_exists(MADV_HUGEPAGE sys/mman.h HAVE_MADV_HUGEPAGE)
+
 check_cxx_source_compiles("
 #include <pthread_np.h>
 int main(int argc, char **argv) {
@@ -8,6 +8,7 @@
 #include <cassert>
 #define __STDC_FORMAT_MACROS
 #include <cinttypes>
+#include <climits>
 #include <memory>
 #include <pthread.h>
 #include <signal.h>
@@ -94,6 +95,7 @@ typedef cpuset_t cpu_set_t;
 #include <unistd.h> // sysconf
 #include "globals.h"
 #include "cgroup.h"
+#include "gcconfig.h"
 
 #ifndef __APPLE__
 #if HAVE_SYSCONF && HAVE__SC_AVPHYS_PAGES
@@ -206,6 +208,12 @@ bool CanFlushUsingMembarrier()
 //
 static int s_flushUsingMemBarrier = 0;
 
+// FlushProcessWriteBuffers statistics
+static uint64_t s_flushCount = 0;
+static uint64_t s_flushTotalTimeNs = 0;
+static uint64_t s_flushMaxTimeNs = 0;
+static uint64_t s_flushFallbackCount = 0;
+
 // Helper memory page used by the FlushProcessWriteBuffers
 static uint8_t* g_helperPage = 0;
 
@@ -215,13 +223,23 @@ static pthread_mutex_t g_flushProcessWriteBuffersMutex;
 size_t GetRestrictedPhysicalMemoryLimit();
 bool GetPhysicalMemoryUsed(size_t* val);
 bool GetCpuLimit(uint32_t* val);
+bool InitializeMemoryPressureNotification(uint32_t stallUs);
+int WaitForMemoryPressureNotification(int timeoutMs);
 
 static size_t g_RestrictedPhysicalMemoryLimit = 0;
 
+// Can we wait for the kernel to report memory pressure on the process
+static bool g_canWaitForMemoryPressure = false;
+
 uint32_t g_pageSizeUnixInl = 0;
 
 AffinitySet g_processAffinitySet;
 
+// Size of the transparent huge pages we ask the OS to back the GC heap with, 0 if we don't
+static size_t g_transparentHugePageSize = 0;
+
+bool ReadMemoryValueFromFile(const char* filename, uint64_t* val);
+
 // The highest NUMA node available
 int g_highestNumaNode = 0;
 // Is numa available
@@ -284,7 +302,7 @@ static bool ShouldOpenLibNuma()
 void NUMASupportInitialize()
 {
 #if HAVE_NUMA_H
-    if (!ShouldOpenLibNuma())
+    if (!GCConfig::GetGCNumaAware() || !ShouldOpenLibNuma())
     {
         g_numaAvailable = false;
         g_highestNumaNode = 0;
@@ -333,6 +351,116 @@ void NUMASupportCleanup()
 #endif // HAVE_NUMA_H
 }
 
+#if HAVE_MADV_HUGEPAGE
+// Get the size of transparent huge pages if the kernel honors madvise(MADV_HUGEPAGE).
+// Return:
+//  Size of a transparent huge page, or 0 if they are disabled
+static size_t GetTransparentHugePageSizeFromOS()
+{
+    // Both the "always" and "madvise" modes honor MADV_HUGEPAGE, "never" doesn't.
+    FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (file == nullptr)
+    {
+        return 0;
+    }
+
+    char* line = nullptr;
+    size_t lineLen = 0;
+    bool enabled = (getline(&line, &lineLen, file) != -1) && (strstr(line, "[never]") == nullptr);
+    free(line);
+    fclose(file);
+
+    if (!enabled)
+    {
+        return 0;
+    }
+
+    uint64_t size = 0;
+    if (!ReadMemoryValueFromFile("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", &size))
+    {
+        // Older kernels don't report it - this is the PMD size with 4K pages.
+        size = 2 * 1024 * 1024;
+    }
+
+    return (size_t)size;
+}
+#endif // HAVE_MADV_HUGEPAGE
+
+#if HAVE_NUMA_H
+// Set the memory policy of a virtual memory range so that its pages are preferably
+// allocated on the specified NUMA node. The policy only affects pages faulted in after
+// this call, so it has to be set before the range is first touched.
+// Parameters:
+//  address - starting virtual address
+//  size    - size of the virtual memory range
+//  node    - the NUMA node
+// Return:
+//  true if it has succeeded, false if it has failed
+static bool BindToNumaNode(void* address, size_t size, uint16_t node)
+{
+    if ((int)node <= g_highestNumaNode)
+    {
+        const int bitsPerMaskWord = sizeof(unsigned long) * 8;
+        int usedNodeMaskBits = g_highestNumaNode + 1;
+        int nodeMaskLength = (usedNodeMaskBits + bitsPerMaskWord - 1) / bitsPerMaskWord;
+        unsigned long nodeMask[nodeMaskLength];
+        memset(nodeMask, 0, sizeof(nodeMask));
+
+        int index = node / bitsPerMaskWord;
+        nodeMask[index] = ((unsigned long)1) << (node % bitsPerMaskWord);
+
+        // The kernel reads one bit less than maxnode, like libnuma we pass one more than the
+        // number of bits in use so that the highest node is included.
+        int st = mbind(address, size, MPOL_PREFERRED, nodeMask, usedNodeMaskBits + 1, 0);
+        assert(st == 0);
+        // If the mbind fails, we still use the memory since the node is just a hint
+        return (st == 0);
+    }
+
+    return false;
+}
+#endif // HAVE_NUMA_H
+
+// Set up the helper page FlushProcessWriteBuffers uses when it can't use membarrier
+// Return:
+//  true if it has succeeded, false if it has failed
+static bool InitializeFlushHelperPage()
+{
+    assert(g_helperPage == 0);
+
+    uint8_t* helperPage = static_cast<uint8_t*>(mmap(0, OS_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0));
+
+    if (helperPage == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // Verify that the s_helperPage is really aligned to the g_SystemInfo.dwPageSize
+    assert((((size_t)helperPage) & (OS_PAGE_SIZE - 1)) == 0);
+
+    // Locking the page ensures that it stays in memory during the two mprotect
+    // calls in the FlushProcessWriteBuffers below. If the page was unmapped between
+    // those calls, they would not have the expected effect of generating IPI.
+    int status = mlock(helperPage, OS_PAGE_SIZE);
+
+    if (status != 0)
+    {
+        munmap(helperPage, OS_PAGE_SIZE);
+        return false;
+    }
+
+    status = pthread_mutex_init(&g_flushProcessWriteBuffersMutex, NULL);
+    if (status != 0)
+    {
+        munlock(helperPage, OS_PAGE_SIZE);
+        munmap(helperPage, OS_PAGE_SIZE);
+        return false;
+    }
+
+    g_helperPage = helperPage;
+    return true;
+}
+
 // Initialize the interface implementation
 // Return:
 //  true if it has succeeded, false if it has failed
@@ -357,38 +485,15 @@ bool GCToOSInterface::Initialize()
 
     assert(s_flushUsingMemBarrier == 0);
 
+    // This registers the process for the private expedited membarrier command if the kernel has it.
     s_flushUsingMemBarrier = CanFlushUsingMembarrier();
 
-    if (!s_flushUsingMemBarrier)
+    // We set up the helper page even if we can use membarrier, so we have something to
+    // fall back to if membarrier starts failing (e.g. due to a seccomp policy). It's only
+    // required if we can't use membarrier in the first place.
+    if (!InitializeFlushHelperPage() && !s_flushUsingMemBarrier)
     {
-        assert(g_helperPage == 0);
-
-        g_helperPage = static_cast<uint8_t*>(mmap(0, OS_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0));
-
-        if (g_helperPage == MAP_FAILED)
-        {
-            return false;
-        }
-
-        // Verify that the s_helperPage is really aligned to the g_SystemInfo.dwPageSize
-        assert((((size_t)g_helperPage) & (OS_PAGE_SIZE - 1)) == 0);
-
-        // Locking the page ensures that it stays in memory during the two mprotect
-        // calls in the FlushProcessWriteBuffers below. If the page was unmapped between
-        // those calls, they would not have the expected effect of generating IPI.
-        int status = mlock(g_helperPage, OS_PAGE_SIZE);
-
-        if (status != 0)
-        {
-            return false;
-        }
-
-        status = pthread_mutex_init(&g_flushProcessWriteBuffersMutex, NULL);
-        if (status != 0)
-        {
-            munlock(g_helperPage, OS_PAGE_SIZE);
-            return false;
-        }
+        return false;
     }
 
 #if HAVE_MACH_ABSOLUTE_TIME
@@ -401,6 +506,11 @@ bool GCToOSInterface::Initialize()
 
     InitializeCGroup();
 
+    if (GCConfig::GetGCMemoryPressureNotification())
+    {
+        g_canWaitForMemoryPressure = InitializeMemoryPressureNotification((uint32_t)GCConfig::GetGCMemoryPressureStallMs() * 1000);
+    }
+
 #if HAVE_SCHED_GETAFFINITY
 
     g_currentProcessCpuCount = 0;
@@ -445,18 +555,28 @@ bool GCToOSInterface::Initialize()
 
     NUMASupportInitialize();
 
+#if HAVE_MADV_HUGEPAGE
+    if (GCConfig::GetGCTHP())
+    {
+        g_transparentHugePageSize = GetTransparentHugePageSizeFromOS();
+    }
+#endif // HAVE_MADV_HUGEPAGE
+
     return true;
 }
 
 // Shutdown the interface implementation
 void GCToOSInterface::Shutdown()
 {
-    int ret = munlock(g_helperPage, OS_PAGE_SIZE);
-    assert(ret == 0);
-    ret = pthread_mutex_destroy(&g_flushProcessWriteBuffersMutex);
-    assert(ret == 0);
+    if (g_helperPage != 0)
+    {
+        int ret = munlock(g_helperPage, OS_PAGE_SIZE);
+        assert(ret == 0);
+        ret = pthread_mutex_destroy(&g_flushProcessWriteBuffersMutex);
+        assert(ret == 0);
 
-    munmap(g_helperPage, OS_PAGE_SIZE);
+        munmap(g_helperPage, OS_PAGE_SIZE);
+    }
 
     CleanupCGroup();
     NUMASupportCleanup();
@@ -519,35 +639,101 @@ bool GCToOSInterface::CanGetCurrentProcessorNumber()
     return HAVE_SCHED_GETCPU;
 }
 
+// Get a timestamp in nanoseconds for measuring how long FlushProcessWriteBuffers takes
+static uint64_t GetFlushTimeStampNs()
+{
+#ifdef CLOCK_MONOTONIC
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * tccSecondsToNanoSeconds + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)GCToOSInterface::QueryPerformanceCounter() * (tccSecondsToNanoSeconds / tccSecondsToMicroSeconds);
+#endif // CLOCK_MONOTONIC
+}
+
+static void RecordFlushTime(uint64_t startNs)
+{
+    uint64_t elapsedNs = GetFlushTimeStampNs() - startNs;
+
+    __sync_add_and_fetch(&s_flushCount, 1);
+    __sync_add_and_fetch(&s_flushTotalTimeNs, elapsedNs);
+
+    uint64_t maxNs = s_flushMaxTimeNs;
+    while (elapsedNs > maxNs)
+    {
+        uint64_t prevMaxNs = __sync_val_compare_and_swap(&s_flushMaxTimeNs, maxNs, elapsedNs);
+        if (prevMaxNs == maxNs)
+        {
+            break;
+        }
+        maxNs = prevMaxNs;
+    }
+}
+
 // Flush write buffers of processors that are executing threads of the current process
 void GCToOSInterface::FlushProcessWriteBuffers()
 {
+    uint64_t startNs = GetFlushTimeStampNs();
+
     if (s_flushUsingMemBarrier)
     {
+        // This only interrupts the CPUs currently running threads of this process and doesn't
+        // take the mm lock, so it's by far the cheapest option.
         int status = membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
-        assert(status == 0 && "Failed to flush using membarrier");
+        if (status == 0)
+        {
+            RecordFlushTime(startNs);
+            return;
+        }
+
+        // The kernel refused - use the helper page from now on (counted in s_flushFallbackCount).
+        if (g_helperPage == 0)
+        {
+            // There is nothing else we can flush with, and going on without a flush
+            // could corrupt the GC heap.
+            fprintf(stderr, "FlushProcessWriteBuffers failed using membarrier, errno %d\n", errno);
+            abort();
+        }
+
+        s_flushUsingMemBarrier = 0;
     }
-    else
-    {
-        int status = pthread_mutex_lock(&g_flushProcessWriteBuffersMutex);
-        assert(status == 0 && "Failed to lock the flushProcessWriteBuffersMutex lock");
 
-        // Changing a helper memory page protection from read / write to no access
-        // causes the OS to issue IPI to flush TLBs on all processors. This also
-        // results in flushing the processor buffers.
-        status = mprotect(g_helperPage, OS_PAGE_SIZE, PROT_READ | PROT_WRITE);
-        assert(status == 0 && "Failed to change helper page protection to read / write");
+    __sync_add_and_fetch(&s_flushFallbackCount, 1);
 
-        // Ensure that the page is dirty before we change the protection so that
-        // we prevent the OS from skipping the global TLB flush.
-        __sync_add_and_fetch((size_t*)g_helperPage, 1);
+    int status = pthread_mutex_lock(&g_flushProcessWriteBuffersMutex);
+    assert(status == 0 && "Failed to lock the flushProcessWriteBuffersMutex lock");
 
-        status = mprotect(g_helperPage, OS_PAGE_SIZE, PROT_NONE);
-        assert(status == 0 && "Failed to change helper page protection to no access");
+    // Changing a helper memory page protection from read / write to no access
+    // causes the OS to issue IPI to flush TLBs on all processors. This also
+    // results in flushing the processor buffers.
+    status = mprotect(g_helperPage, OS_PAGE_SIZE, PROT_READ | PROT_WRITE);
+    assert(status == 0 && "Failed to change helper page protection to read / write");
 
-        status = pthread_mutex_unlock(&g_flushProcessWriteBuffersMutex);
-        assert(status == 0 && "Failed to unlock the flushProcessWriteBuffersMutex lock");
-    }
+    // Ensure that the page is dirty before we change the protection so that
+    // we prevent the OS from skipping the global TLB flush.
+    __sync_add_and_fetch((size_t*)g_helperPage, 1);
+
+    status = mprotect(g_helperPage, OS_PAGE_SIZE, PROT_NONE);
+    assert(status == 0 && "Failed to change helper page protection to no access");
+
+    status = pthread_mutex_unlock(&g_flushProcessWriteBuffersMutex);
+    assert(status == 0 && "Failed to unlock the flushProcessWriteBuffersMutex lock");
+
+    RecordFlushTime(startNs);
+}
+
+// Get statistics about the FlushProcessWriteBuffers calls made so far
+// Parameters:
+//  flushCount    - set to the number of flushes
+//  totalTimeNs   - set to the total time spent flushing, in nanoseconds
+//  maxTimeNs     - set to the longest single flush, in nanoseconds
+//  fallbackCount - set to the number of flushes that couldn't use membarrier
+void GCToOSInterface::GetFlushProcessWriteBuffersStats(uint64_t* flushCount, uint64_t* totalTimeNs, uint64_t* maxTimeNs, uint64_t* fallbackCount)
+{
+    *flushCount = s_flushCount;
+    *totalTimeNs = s_flushTotalTimeNs;
+    *maxTimeNs = s_flushMaxTimeNs;
+    *fallbackCount = s_flushFallbackCount;
 }
 
 // Break into a debugger. Uses a compiler intrinsic if one is available,
@@ -650,7 +836,23 @@ static void* VirtualReserveInner(size_t size, size_t alignment, uint32_t flags,
 //  Starting virtual address of the reserved range
 void* GCToOSInterface::VirtualReserve(size_t size, size_t alignment, uint32_t flags, uint16_t node)
 {
-    return VirtualReserveInner(size, alignment, flags);
+    if ((g_transparentHugePageSize != 0) && (size >= g_transparentHugePageSize))
+    {
+        // The kernel can only back naturally aligned ranges with huge pages.
+        alignment = std::max(alignment, g_transparentHugePageSize);
+    }
+
+    void* pRetVal = VirtualReserveInner(size, alignment, flags);
+
+#if HAVE_NUMA_H
+    if ((pRetVal != NULL) && g_numaAvailable && (node != NUMA_NODE_UNDEFINED))
+    {
+        // Nothing in the range has been faulted in yet, so the whole range will follow this.
+        BindToNumaNode(pRetVal, size, node);
+    }
+#endif // HAVE_NUMA_H
+
+    return pRetVal;
 }
 
 // Release virtual memory range previously reserved using VirtualReserve
@@ -700,23 +902,22 @@ bool GCToOSInterface::VirtualCommit(void* address, size_t size, uint16_t node)
 {
     bool success = mprotect(address, size, PROT_WRITE | PROT_READ) == 0;
 
+#if HAVE_MADV_HUGEPAGE
+    if (success && (g_transparentHugePageSize != 0))
+    {
+        // VirtualDecommit maps fresh pages over the range, which drops the advice, so we
+        // apply it on every commit. It's only a hint, so we ignore failures.
+        madvise(address, size, MADV_HUGEPAGE);
+    }
+#endif // HAVE_MADV_HUGEPAGE
+
 #if HAVE_NUMA_H
     if (success && g_numaAvailable && (node != NUMA_NODE_UNDEFINED))
     {
-        if ((int)node <= g_highestNumaNode)
-        {
-            int usedNodeMaskBits = g_highestNumaNode + 1;
-            int nodeMaskLength = (usedNodeMaskBits + sizeof(unsigned long) - 1) / sizeof(unsigned long);
-            unsigned long nodeMask[nodeMaskLength];
-            memset(nodeMask, 0, sizeof(nodeMask));
-
-            int index = node / sizeof(unsigned long);
-            nodeMask[index] = ((unsigned long)1) << (node & (sizeof(unsigned long) - 1));
-
-            int st = mbind(address, size, MPOL_PREFERRED, nodeMask, usedNodeMaskBits, 0);
-            assert(st == 0);
-            // If the mbind fails, we still return the allocated memory since the node is just a hint
-        }
+        // VirtualDecommit maps fresh pages over the range, which drops the policy set at
+        // reservation time. Committing doesn't fault anything in, so binding here still
+        // covers every page of the range.
+        BindToNumaNode(address, size, node);
     }
 #endif // HAVE_NUMA_H
 
@@ -765,6 +966,34 @@ bool GCToOSInterface::VirtualReset(void * address, size_t size, bool unlock)
     return (st == 0);
 }
 
+// Get the size of the transparent huge pages the OS backs the committed memory with
+// Return:
+//  Size of a transparent huge page, or 0 if they are not used
+size_t GCToOSInterface::GetTransparentHugePageSize()
+{
+    return g_transparentHugePageSize;
+}
+
+// Make the pages of a committed virtual memory range that haven't been touched yet preferably
+// allocated on the specified NUMA node. Pages that are already backed by memory are not moved.
+// Parameters:
+//  address - starting virtual address, page aligned
+//  size    - size of the virtual memory range
+//  node    - the NUMA node
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::VirtualBindToNumaNode(void* address, size_t size, uint16_t node)
+{
+#if HAVE_NUMA_H
+    if (g_numaAvailable && (node != NUMA_NODE_UNDEFINED))
+    {
+        return BindToNumaNode(address, size, node);
+    }
+#endif // HAVE_NUMA_H
+
+    return false;
+}
+
 // Check if the OS supports write watching
 bool GCToOSInterface::SupportsWriteWatch()
 {
@@ -1308,6 +1537,30 @@ void GCToOSInterface::GetMemoryStatus(uint64_t restricted_limit, uint32_t* memor
         *available_page_file = GetAvailablePageFile();
 }
 
+// Check if the OS can notify us about memory pressure on the process
+bool GCToOSInterface::CanWaitForMemoryPressure()
+{
+    return g_canWaitForMemoryPressure;
+}
+
+// Wait for the OS to report memory pressure on the process. On Linux this comes from a
+// cgroup v2 PSI trigger or from the cgroup going over memory.high. Only one thread may wait
+// at a time.
+// Parameters:
+//  timeout - timeout in milliseconds, or INFINITE
+// Return:
+//  true if memory pressure was reported, false if the wait timed out or failed
+bool GCToOSInterface::WaitForMemoryPressure(uint32_t timeout)
+{
+    if (!g_canWaitForMemoryPressure)
+    {
+        return false;
+    }
+
+    int timeoutMs = (timeout == INFINITE) ? -1 : (int)std::min(timeout, (uint32_t)INT_MAX);
+    return WaitForMemoryPressureNotification(timeoutMs) == 1;
+}
+
 // Get a high precision performance counter
 // Return:
 //  The counter value
@@ -23,6 +23,9 @@ static bool g_SeLockMemoryPrivilegeAcquired = false;
 
 static AffinitySet g_processAffinitySet;
 
+// Signaled by the OS while physical memory is low, NULL if we aren't asking for it
+static HANDLE g_lowMemoryNotification = NULL;
+
 namespace {
 
 static bool g_fEnableGCNumaAware;
@@ -539,13 +542,22 @@ bool GCToOSInterface::Initialize()
         }
     }
 
+    if (GCConfig::GetGCMemoryPressureNotification())
+    {
+        g_lowMemoryNotification = ::CreateMemoryResourceNotification(LowMemoryResourceNotification);
+    }
+
     return true;
 }
 
 // Shutdown the interface implementation
 void GCToOSInterface::Shutdown()
 {
-    // nothing to do.
+    if (g_lowMemoryNotification != NULL)
+    {
+        ::CloseHandle(g_lowMemoryNotification);
+        g_lowMemoryNotification = NULL;
+    }
 }
 
 // Get numeric id of the current thread if possible on the
@@ -647,6 +659,21 @@ void GCToOSInterface::FlushProcessWriteBuffers()
     ::FlushProcessWriteBuffers();
 }
 
+// Get statistics about the FlushProcessWriteBuffers calls made so far
+// Parameters:
+//  flushCount    - set to the number of flushes
+//  totalTimeNs   - set to the total time spent flushing, in nanoseconds
+//  maxTimeNs     - set to the longest single flush, in nanoseconds
+//  fallbackCount - set to the number of flushes that couldn't use the preferred OS mechanism
+void GCToOSInterface::GetFlushProcessWriteBuffersStats(uint64_t* flushCount, uint64_t* totalTimeNs, uint64_t* maxTimeNs, uint64_t* fallbackCount)
+{
+    // The OS does this with a single IPI-based call, we don't track it.
+    *flushCount = 0;
+    *totalTimeNs = 0;
+    *maxTimeNs = 0;
+    *fallbackCount = 0;
+}
+
 // Break into a debugger
 void GCToOSInterface::DebugBreak()
 {
@@ -789,6 +816,32 @@ bool GCToOSInterface::VirtualReset(void * address, size_t size, bool unlock)
     return success;
 }
 
+// Get the size of the transparent huge pages the OS backs the committed memory with
+// Return:
+//  Size of a transparent huge page, or 0 if they are not used
+size_t GCToOSInterface::GetTransparentHugePageSize()
+{
+    // Windows only has large pages, which are committed up front.
+    return 0;
+}
+
+// Make the pages of a committed virtual memory range that haven't been touched yet preferably
+// allocated on the specified NUMA node. Pages that are already backed by memory are not moved.
+// Parameters:
+//  address - starting virtual address, page aligned
+//  size    - size of the virtual memory range
+//  node    - the NUMA node
+// Return:
+//  true if it has succeeded, false if it has failed
+bool GCToOSInterface::VirtualBindToNumaNode(void* address, size_t size, uint16_t node)
+{
+    // The preferred node can only be given when committing (VirtualAllocExNuma).
+    UNREFERENCED_PARAMETER(address);
+    UNREFERENCED_PARAMETER(size);
+    UNREFERENCED_PARAMETER(node);
+    return false;
+}
+
 // Check if the OS supports write watching
 bool GCToOSInterface::SupportsWriteWatch()
 {
@@ -1101,6 +1154,28 @@ void GCToOSInterface::GetMemoryStatus(uint64_t restricted_limit, uint32_t* memor
     }
 }
 
+// Check if the OS can notify us about memory pressure on the process
+bool GCToOSInterface::CanWaitForMemoryPressure()
+{
+    return g_lowMemoryNotification != NULL;
+}
+
+// Wait for the OS to report memory pressure on the process. The notification stays signaled
+// for as long as memory is low, so callers should limit how often they act on it.
+// Parameters:
+//  timeout - timeout in milliseconds, or INFINITE
+// Return:
+//  true if memory pressure was reported, false if the wait timed out or failed
+bool GCToOSInterface::WaitForMemoryPressure(uint32_t timeout)
+{
+    if (g_lowMemoryNotification == NULL)
+    {
+        return false;
+    }
+
+    return ::WaitForSingleObject(g_lowMemoryNotification, timeout) == WAIT_OBJECT_0;
+}
+
 // Get a high precision performance counter
 // Return:
 //  The counter value
@@ -91,6 +91,41 @@ namespace System.Runtime
         }
     }
 
+    // One exception dispatch timed by EH.DispatchEx when exception profiling is enabled (RH_ExceptionProfiling).
+    // Keep this synchronized with the definition in ExceptionProfiling.h
+    [StructLayout(LayoutKind.Sequential)]
+    internal unsafe struct ExceptionDispatchRecord
+    {
+        internal byte* _throwIP;
+        internal byte* _catchIP;
+        internal byte* _handlerIP;
+        internal EEType* _pExceptionType;
+        internal uint _kind;
+        internal uint _pass1FrameCount;
+        internal uint _pass2FrameCount;
+        internal uint _funcletCount;
+        internal ulong _pass1Ticks;
+        internal ulong _pass2Ticks;
+        internal ulong _threadId;
+        internal ulong _timeStamp;
+    }
+
+    // Keep this synchronized with the definition in ExceptionProfiling.h
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct ExceptionProfileStats
+    {
+        internal ulong _tickFrequency;
+        internal ulong _dispatchCount;
+        internal ulong _rethrowCount;
+        internal ulong _hardwareFaultCount;
+        internal ulong _pass1FrameCount;
+        internal ulong _pass2FrameCount;
+        internal ulong _funcletCount;
+        internal ulong _pass1Ticks;
+        internal ulong _pass2Ticks;
+        internal ulong _sampleCount;
+    }
+
     internal static unsafe partial class EH
     {
         internal static UIntPtr MaxSP
@@ -638,6 +673,10 @@ namespace System.Runtime
             Debug.Assert(exInfo._passNumber == 1, "expected asm throw routine to set the pass");
             object exceptionObj = exInfo.ThrownException;
 
+            // 0 unless exception profiling is enabled
+            ulong pass1StartTicks = InternalCalls.RhpGetExceptionProfilingTimestamp();
+            uint pass1FrameCount = 0;
+
             // ------------------------------------------------
             //
             // First pass
@@ -657,6 +696,7 @@ namespace System.Runtime
 
             bool isValid = frameIter.Init(exInfo._pExContext, (exInfo._kind & ExKind.InstructionFaultFlag) != 0);
             Debug.Assert(isValid, "RhThrowEx called with an unexpected context");
+            byte* throwIP = frameIter.OriginalControlPC;
 
             OnFirstChanceExceptionViaClassLib(exceptionObj);
             DebuggerNotify.BeginFirstPass(exceptionObj, frameIter.OriginalControlPC, frameIter.SP);
@@ -668,6 +708,7 @@ namespace System.Runtime
                 if (unwoundReversePInvoke)
                     break;
 
+                pass1FrameCount++;
                 prevControlPC = frameIter.ControlPC;
                 prevOriginalPC = frameIter.OriginalControlPC;
 
@@ -721,6 +762,10 @@ namespace System.Runtime
             // funclets will always toggle this mode off before invoking them.
             InternalCalls.RhpSetThreadDoNotTriggerGC();
 
+            ulong pass2StartTicks = (pass1StartTicks != 0) ? InternalCalls.RhpGetExceptionProfilingTimestamp() : 0;
+            uint pass2FrameCount = 0;
+            uint funcletCount = 0;
+
             exInfo._passNumber = 2;
             startIdx = MaxTryRegionIdx;
             isValid = frameIter.Init(exInfo._pExContext, (exInfo._kind & ExKind.InstructionFaultFlag) != 0);
@@ -729,6 +774,8 @@ namespace System.Runtime
                 Debug.Assert(isValid, "second-pass EH unwind failed unexpectedly");
                 DebugScanCallFrame(exInfo._passNumber, frameIter.ControlPC, frameIter.SP);
 
+                pass2FrameCount++;
+
                 if ((frameIter.SP == handlingFrameSP)
 #if TARGET_ARM64
                     && (frameIter.ControlPC == prevControlPC)
@@ -736,11 +783,27 @@ namespace System.Runtime
                     )
                 {
                     // invoke only a partial second-pass here...
-                    InvokeSecondPass(ref exInfo, startIdx, catchingTryRegionIdx);
+                    funcletCount += InvokeSecondPass(ref exInfo, startIdx, catchingTryRegionIdx);
                     break;
                 }
 
-                InvokeSecondPass(ref exInfo, startIdx);
+                funcletCount += InvokeSecondPass(ref exInfo, startIdx);
+            }
+
+            if (pass1StartTicks != 0)
+            {
+                ExceptionDispatchRecord record = default(ExceptionDispatchRecord);
+                record._throwIP = throwIP;
+                record._catchIP = prevOriginalPC;
+                record._handlerIP = pCatchHandler;
+                record._pExceptionType = exceptionObj.EEType;
+                record._kind = (uint)exInfo._kind;
+                record._pass1FrameCount = pass1FrameCount;
+                record._pass2FrameCount = pass2FrameCount;
+                record._funcletCount = funcletCount;
+                record._pass1Ticks = pass2StartTicks - pass1StartTicks;
+                record._pass2Ticks = InternalCalls.RhpGetExceptionProfilingTimestamp() - pass2StartTicks;
+                InternalCalls.RhpRecordExceptionDispatch(&record);
             }
 
             // ------------------------------------------------
@@ -902,16 +965,19 @@ namespace System.Runtime
             return TypeCast.IsInstanceOfClass(pClauseType, exception) != null;
         }
 
-        private static void InvokeSecondPass(ref ExInfo exInfo, uint idxStart)
+        // Returns the number of finally and fault funclets called
+        private static uint InvokeSecondPass(ref ExInfo exInfo, uint idxStart)
         {
-            InvokeSecondPass(ref exInfo, idxStart, MaxTryRegionIdx);
+            return InvokeSecondPass(ref exInfo, idxStart, MaxTryRegionIdx);
         }
-        private static void InvokeSecondPass(ref ExInfo exInfo, uint idxStart, uint idxLimit)
+        private static uint InvokeSecondPass(ref ExInfo exInfo, uint idxStart, uint idxLimit)
         {
+            uint funcletCount = 0;
+
             EHEnum ehEnum;
             byte* pbMethodStartAddress;
             if (!InternalCalls.RhpEHEnumInitFromStackFrameIterator(ref exInfo._frameIter, &pbMethodStartAddress, &ehEnum))
-                return;
+                return funcletCount;
 
             byte* pbControlPC = exInfo._frameIter.ControlPC;
 
@@ -970,7 +1036,10 @@ namespace System.Runtime
                 exInfo._idxCurClause = curIdx;
                 InternalCalls.RhpCallFinallyFunclet(pFinallyHandler, exInfo._frameIter.RegisterSet);
                 exInfo._idxCurClause = MaxTryRegionIdx;
+                funcletCount++;
             }
+
+            return funcletCount;
         }
 
         [UnmanagedCallersOnly(EntryPoint = "RhpFailFastForPInvokeExceptionPreemp", CallingConvention = CallingConvention.Cdecl)]
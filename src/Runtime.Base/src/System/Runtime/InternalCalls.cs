@@ -273,6 +273,20 @@ namespace System.Runtime
         [DllImport(Redhawk.BaseName)]
         internal static extern unsafe void RhpSendExceptionEventToDebugger(ExceptionEventKind eventKind, byte* ip, UIntPtr sp);
 
+        //
+        // Exception profiling
+        //
+
+        [RuntimeImport(Redhawk.BaseName, "RhpGetExceptionProfilingTimestamp")]
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [ManuallyManaged(GcPollPolicy.Never)]
+        internal static extern ulong RhpGetExceptionProfilingTimestamp();
+
+        [RuntimeImport(Redhawk.BaseName, "RhpRecordExceptionDispatch")]
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [ManuallyManaged(GcPollPolicy.Never)]
+        internal static extern unsafe void RhpRecordExceptionDispatch(ExceptionDispatchRecord* pRecord);
+
         //
         // Miscellaneous helpers.
         //
@@ -380,6 +394,10 @@ namespace System.Runtime
         [DllImport(Redhawk.BaseName, CallingConvention = CallingConvention.Cdecl)]
         internal static extern uint RhpWaitForFinalizerRequest();
 
+        // Perform the garbage collection the finalizer thread initiates when memory is low.
+        [DllImport(Redhawk.BaseName, CallingConvention = CallingConvention.Cdecl)]
+        internal static extern void RhpCollectForLowMemory();
+
         // Indicate that the current round of finalizations is complete.
         [DllImport(Redhawk.BaseName, CallingConvention = CallingConvention.Cdecl)]
         internal static extern void RhpSignalFinalizationComplete();
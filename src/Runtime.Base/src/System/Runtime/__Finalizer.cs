@@ -38,8 +38,9 @@ namespace System.Runtime
                 else
                 {
                     // RhpWaitForFinalizerRequest() returned false and indicated that memory is low. We help
-                    // out by initiating a garbage collection and then go back to waiting for another request.
-                    InternalCalls.RhCollect(-1, InternalGCCollectionMode.Blocking);
+                    // out by initiating a garbage collection (gen1 first, full only if the pressure persists)
+                    // and then go back to waiting for another request.
+                    InternalCalls.RhpCollectForLowMemory();
                 }
             }
         }
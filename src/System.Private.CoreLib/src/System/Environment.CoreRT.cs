@@ -57,6 +57,7 @@ namespace System
 
 #if !TARGET_WASM // WASMTODO Be careful what happens here as if the code has called emscripten_set_main_loop then the main loop method will normally be called repeatedly after this method
             AppContext.OnProcessExit();
+            RuntimeDiagnostics.OnProcessExit();
 #endif
         }
 
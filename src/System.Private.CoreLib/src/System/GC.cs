@@ -104,6 +104,129 @@ namespace System
         private TimeSpan _pauseDuration1;
 
         internal ReadOnlySpan<TimeSpan> PauseDurationsAsSpan => MemoryMarshal.CreateReadOnlySpan<TimeSpan>(ref _pauseDuration0, 2);
+
+        internal long _pinnedPlugCount;
+        internal long _pinnedPlugSizeBytes;
+        internal long _pinnedPlugFragmentationBytes;
+    }
+
+    // keep in sync with gc_pause_kind in gcinterface.h
+    internal enum GCPauseKind
+    {
+        BlockingGen0 = 0, // whole pause of a blocking gen0 GC, including suspension
+        BlockingGen1 = 1, // whole pause of a blocking gen1 GC, including suspension
+        BlockingGen2 = 2, // whole pause of a blocking gen2 GC, including suspension
+        Background = 3,   // each of the two pauses of a background GC
+        Suspension = 4,   // time it took to suspend the runtime for a GC
+        Mark = 5,         // mark phase of a blocking GC
+        Plan = 6,         // plan phase of a blocking GC, excluding relocate and compact
+        Relocate = 7,     // relocate phase of a compacting GC
+        Compact = 8,      // compact phase of a compacting GC
+    }
+
+    // keep in sync with RH_GC_PAUSE_STATS in GCHelpers.cpp
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct GCPauseStatsData
+    {
+        internal long _count;
+        internal long _totalMicroseconds;
+        internal long _maxMicroseconds;
+        internal long _p50Microseconds;
+        internal long _p90Microseconds;
+        internal long _p99Microseconds;
+        internal long _p999Microseconds;
+    }
+
+    // keep in sync with gc_history_generation in gcinterface.h
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct GCHistoryGenerationData
+    {
+        internal long _sizeBeforeBytes;
+        internal long _sizeAfterBytes;
+        internal long _fragmentationBeforeBytes;
+        internal long _fragmentationAfterBytes;
+        internal long _survivedBytes;
+        internal long _pinnedSurvivedBytes;
+        internal long _promotedInBytes;
+    }
+
+    // keep in sync with gc_history_record in gcinterface.h, the reason and mechanism
+    // values are the ones of gcrecord.h
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct GCHistoryRecordData
+    {
+        internal long _index;
+        internal uint _heapIndex;
+        internal uint _heapCount;
+        internal int _condemnedGeneration;
+        internal int _reason;
+        internal int _pauseMode;
+        internal uint _memoryLoad;
+        internal uint _globalMechanisms;
+        internal uint _globalCondemnReasonsGen;
+        internal uint _globalCondemnReasonsCondition;
+        internal uint _condemnReasonsGen;
+        internal uint _condemnReasonsCondition;
+        internal int _compactReason;
+        internal int _expandMechanism;
+        internal uint _mechanismBits;
+        internal long _extraGen0CommittedBytes;
+        internal long _remoteNodeAllocSwitches;
+        internal long _cardMarkMicroseconds;
+        internal long _cardMarkStealMicroseconds;
+        internal GCHistoryGenerationData _gen0;
+        internal GCHistoryGenerationData _gen1;
+        internal GCHistoryGenerationData _gen2;
+        internal GCHistoryGenerationData _loh;
+        internal GCHistoryGenerationData _poh;
+    }
+
+    // keep in sync with gc_join_kind in gcinterface.h
+    internal enum GCJoinKind
+    {
+        Server = 0,     // joins of blocking GCs, and of the part of a background GC done while suspended
+        Background = 1, // joins of the background GC threads
+    }
+
+    // keep in sync with gc_join_stage_stats in gcinterface.h, times are in microseconds
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct GCJoinStageStatsData
+    {
+        internal uint _joinCount;
+        internal uint _spinCount;
+        internal uint _blockCount;
+        internal int _lastHeap;
+        internal long _waitTime;
+        internal long _serialTime;
+    }
+
+    // keep in sync with gc_join_heap_stats in gcinterface.h
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct GCJoinHeapStatsData
+    {
+        internal uint _lastArrivalCount;
+        internal uint _reserved;
+        internal long _waitTime;
+    }
+
+    // keep in sync with gc_join_stats in gcinterface.h
+    [StructLayout(LayoutKind.Sequential)]
+    internal unsafe struct GCJoinStatsData
+    {
+        internal const int MaxStages = 64; // GC_JOIN_STATS_MAX_STAGES
+
+        internal long _gcIndex;
+        internal uint _heapCount;
+        internal uint _stageCount;
+        private fixed long _stages[MaxStages * 4]; // GCJoinStageStatsData[MaxStages]
+
+        internal GCJoinStageStatsData GetStage(int stage)
+        {
+            fixed (long* pStages = _stages)
+            {
+                return ((GCJoinStageStatsData*)pStages)[stage];
+            }
+        }
     }
 
     // TODO: deduplicate with shared CoreLib
@@ -714,6 +837,18 @@ namespace System
                                     fragmentedBytes: data._fragmentedBytes);
         }
 
+        // Pinned plugs of the last GC of the given kind: how many there were, their total size and, if that GC
+        // compacted, the free space it had to leave in front of them. GCMemoryInfo is shared with CoreCLR, so
+        // these are not part of it.
+        internal static void GetPinnedPlugInfo(GCKind kind, out long count, out long sizeBytes, out long fragmentationBytes)
+        {
+            RuntimeImports.RhGetMemoryInfo(out GCMemoryInfoData data, kind);
+
+            count = data._pinnedPlugCount;
+            sizeBytes = data._pinnedPlugSizeBytes;
+            fragmentationBytes = data._pinnedPlugFragmentationBytes;
+        }
+
         internal static ulong GetSegmentSize()
         {
             return RuntimeImports.RhGetGCSegmentSize();
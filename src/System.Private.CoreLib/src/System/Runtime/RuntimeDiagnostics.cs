@@ -0,0 +1,222 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+using System.IO;
+using System.Text;
+
+namespace System.Runtime
+{
+    // Writes the runtime's diagnostic statistics to a text file when the process exits, so they can be collected
+    // without a debugger or a tracer. This is off unless the app sets the System.Runtime.DiagnosticsReportPath
+    // AppContext data to the path of the file (AppContext.SetData). Each line is a section name followed by
+    // name=value pairs. Setting System.Runtime.HeapSnapshotPath also takes a heap snapshot (see
+    // src/Native/Runtime/HeapSnapshot.h) into that file before the report is written.
+    internal static class RuntimeDiagnostics
+    {
+        private const string ReportPathName = "System.Runtime.DiagnosticsReportPath";
+        private const string HeapSnapshotPathName = "System.Runtime.HeapSnapshotPath";
+
+        // Default GCHistorySize, the GC keeps this many per heap records unless configured otherwise
+        private const int MaxGCHistoryRecords = 256;
+
+        // EXCEPTION_PROFILE_SAMPLE_COUNT, the number of sampled exception dispatches the runtime keeps
+        private const int MaxExceptionSamples = 256;
+
+        // In GCPauseKind order
+        private static readonly string[] s_pauseKindNames =
+        {
+            "blocking-gen0",
+            "blocking-gen1",
+            "blocking-gen2",
+            "background",
+            "suspension",
+            "mark",
+            "plan",
+            "relocate",
+            "compact",
+        };
+
+        internal static void OnProcessExit()
+        {
+            string snapshotPath = AppContext.GetData(HeapSnapshotPathName) as string;
+            bool snapshotWritten = false;
+            if (!string.IsNullOrEmpty(snapshotPath))
+                snapshotWritten = WriteHeapSnapshot(snapshotPath);
+
+            string path = AppContext.GetData(ReportPathName) as string;
+            if (string.IsNullOrEmpty(path))
+                return;
+
+            try
+            {
+                using (StreamWriter writer = new StreamWriter(path))
+                {
+                    WriteGCPauses(writer);
+                    WritePinnedPlugs(writer, GCKind.Ephemeral, "ephemeral");
+                    WritePinnedPlugs(writer, GCKind.FullBlocking, "full-blocking");
+                    WritePinnedPlugs(writer, GCKind.Background, "background");
+                    WriteFlushProcessWriteBuffers(writer);
+                    WriteGCHistory(writer);
+                    WriteGCJoins(writer, GCJoinKind.Server, "server");
+                    WriteGCJoins(writer, GCJoinKind.Background, "background");
+                    WriteExceptionProfile(writer);
+
+                    if (!string.IsNullOrEmpty(snapshotPath))
+                        writer.WriteLine($"heap-snapshot path={snapshotPath} written={snapshotWritten}");
+                }
+            }
+            catch (Exception e) when (e is IOException || e is UnauthorizedAccessException)
+            {
+                // The report is best effort, failing to write it must not fail the shutdown.
+            }
+        }
+
+        private static unsafe bool WriteHeapSnapshot(string path)
+        {
+            byte[] utf8Path = new byte[Encoding.UTF8.GetByteCount(path) + 1];
+            Encoding.UTF8.GetBytes(path, 0, path.Length, utf8Path, 0);
+            fixed (byte* pUtf8Path = utf8Path)
+            {
+                return RuntimeImports.RhWriteHeapSnapshot(pUtf8Path) != 0;
+            }
+        }
+
+        private static unsafe void WriteGCPauses(StreamWriter writer)
+        {
+            // All the kinds have the same number of buckets
+            int bucketCount = RuntimeImports.RhGetGCPauseHistogram(GCPauseKind.BlockingGen0, null, 0);
+            uint* buckets = stackalloc uint[bucketCount];
+
+            for (int kind = 0; kind < s_pauseKindNames.Length; kind++)
+            {
+                RuntimeImports.RhGetGCPauseStats((GCPauseKind)kind, out GCPauseStatsData stats);
+                if (stats._count == 0)
+                    continue;
+
+                writer.WriteLine($"gc-pause kind={s_pauseKindNames[kind]} count={stats._count} total-us={stats._totalMicroseconds} max-us={stats._maxMicroseconds} " +
+                                 $"p50-us={stats._p50Microseconds} p90-us={stats._p90Microseconds} p99-us={stats._p99Microseconds} p999-us={stats._p999Microseconds}");
+
+                RuntimeImports.RhGetGCPauseHistogram((GCPauseKind)kind, buckets, bucketCount);
+
+                writer.Write($"gc-pause-histogram kind={s_pauseKindNames[kind]}");
+                for (int i = 0; i < bucketCount; i++)
+                    writer.Write($" {i}={buckets[i]}");
+                writer.WriteLine();
+            }
+        }
+
+        // Pinned plugs of the last GC of the given kind
+        private static void WritePinnedPlugs(StreamWriter writer, GCKind kind, string kindName)
+        {
+            GC.GetPinnedPlugInfo(kind, out long count, out long sizeBytes, out long fragmentationBytes);
+            writer.WriteLine($"gc-pinned-plugs kind={kindName} count={count} size={sizeBytes} fragmentation={fragmentationBytes}");
+        }
+
+        private static void WriteFlushProcessWriteBuffers(StreamWriter writer)
+        {
+            RuntimeImports.RhGetFlushProcessWriteBuffersStats(out ulong flushCount, out ulong totalTimeNs, out ulong maxTimeNs, out ulong fallbackCount);
+            writer.WriteLine($"flush-process-write-buffers count={flushCount} total-ns={totalTimeNs} max-ns={maxTimeNs} fallback-count={fallbackCount}");
+        }
+
+        private static unsafe void WriteGCHistory(StreamWriter writer)
+        {
+            GCHistoryRecordData[] records = new GCHistoryRecordData[MaxGCHistoryRecords];
+            int recordCount;
+            fixed (GCHistoryRecordData* pRecords = records)
+            {
+                recordCount = RuntimeImports.RhGetGCHistory(pRecords, records.Length);
+            }
+
+            // Oldest first
+            for (int i = 0; i < recordCount; i++)
+            {
+                ref GCHistoryRecordData record = ref records[i];
+                writer.Write($"gc-history index={record._index} heap={record._heapIndex} heap-count={record._heapCount} gen={record._condemnedGeneration} " +
+                             $"reason={record._reason} pause-mode={record._pauseMode} memory-load={record._memoryLoad} " +
+                             $"global-mechanisms=0x{record._globalMechanisms:x} global-condemn-gen=0x{record._globalCondemnReasonsGen:x} " +
+                             $"global-condemn-condition=0x{record._globalCondemnReasonsCondition:x} condemn-gen=0x{record._condemnReasonsGen:x} " +
+                             $"condemn-condition=0x{record._condemnReasonsCondition:x} compact-reason={record._compactReason} " +
+                             $"expand-mechanism={record._expandMechanism} mechanisms=0x{record._mechanismBits:x} " +
+                             $"extra-gen0-committed={record._extraGen0CommittedBytes} remote-node-alloc-switches={record._remoteNodeAllocSwitches} " +
+                             $"card-mark-us={record._cardMarkMicroseconds} card-mark-steal-us={record._cardMarkStealMicroseconds}");
+                WriteGCHistoryGeneration(writer, "gen0", ref record._gen0);
+                WriteGCHistoryGeneration(writer, "gen1", ref record._gen1);
+                WriteGCHistoryGeneration(writer, "gen2", ref record._gen2);
+                WriteGCHistoryGeneration(writer, "loh", ref record._loh);
+                WriteGCHistoryGeneration(writer, "poh", ref record._poh);
+                writer.WriteLine();
+            }
+        }
+
+        private static void WriteGCHistoryGeneration(StreamWriter writer, string name, ref GCHistoryGenerationData generation)
+        {
+            writer.Write($" {name}-size-before={generation._sizeBeforeBytes} {name}-size-after={generation._sizeAfterBytes} " +
+                         $"{name}-frag-before={generation._fragmentationBeforeBytes} {name}-frag-after={generation._fragmentationAfterBytes} " +
+                         $"{name}-survived={generation._survivedBytes} {name}-pinned-survived={generation._pinnedSurvivedBytes} " +
+                         $"{name}-promoted-in={generation._promotedInBytes}");
+        }
+
+        // Join statistics of the last GC of the given kind. They are only kept by the server GC.
+        private static unsafe void WriteGCJoins(StreamWriter writer, GCJoinKind kind, string kindName)
+        {
+            GCJoinStatsData stats;
+            int heapCount = RuntimeImports.RhGetGCJoinStats(kind, &stats, null, 0);
+
+            GCJoinHeapStatsData[] heapStats = new GCJoinHeapStatsData[heapCount];
+            fixed (GCJoinHeapStatsData* pHeapStats = heapStats)
+            {
+                heapCount = Math.Min(heapCount, RuntimeImports.RhGetGCJoinStats(kind, &stats, pHeapStats, heapStats.Length));
+            }
+
+            writer.WriteLine($"gc-join kind={kindName} gc-index={stats._gcIndex} heap-count={stats._heapCount} stage-count={stats._stageCount}");
+
+            for (int i = 0; i < (int)stats._stageCount; i++)
+            {
+                GCJoinStageStatsData stage = stats.GetStage(i);
+                if (stage._joinCount == 0)
+                    continue;
+
+                writer.WriteLine($"gc-join-stage kind={kindName} stage={i} joins={stage._joinCount} spins={stage._spinCount} blocks={stage._blockCount} " +
+                                 $"last-heap={stage._lastHeap} wait-us={stage._waitTime} serial-us={stage._serialTime}");
+            }
+
+            for (int i = 0; i < heapCount; i++)
+            {
+                writer.WriteLine($"gc-join-heap kind={kindName} heap={i} last-arrivals={heapStats[i]._lastArrivalCount} wait-us={heapStats[i]._waitTime}");
+            }
+        }
+
+        // Exception dispatch totals and samples, newest first. They are only kept when RH_ExceptionProfiling is set.
+        private static unsafe void WriteExceptionProfile(StreamWriter writer)
+        {
+            ExceptionProfileStats stats;
+            ExceptionDispatchRecord[] samples = new ExceptionDispatchRecord[MaxExceptionSamples];
+            int sampleCount;
+            fixed (ExceptionDispatchRecord* pSamples = samples)
+            {
+                sampleCount = RuntimeImports.RhGetExceptionProfile(&stats, pSamples, samples.Length);
+            }
+
+            ulong tickFrequency = stats._tickFrequency;
+            writer.WriteLine($"exception-profile dispatches={stats._dispatchCount} rethrows={stats._rethrowCount} hardware-faults={stats._hardwareFaultCount} " +
+                             $"pass1-frames={stats._pass1FrameCount} pass2-frames={stats._pass2FrameCount} funclets={stats._funcletCount} " +
+                             $"pass1-us={TicksToMicroseconds(stats._pass1Ticks, tickFrequency)} pass2-us={TicksToMicroseconds(stats._pass2Ticks, tickFrequency)} " +
+                             $"samples={stats._sampleCount}");
+
+            for (int i = 0; i < sampleCount; i++)
+            {
+                ref ExceptionDispatchRecord sample = ref samples[i];
+                writer.WriteLine($"exception-sample type=0x{(ulong)sample._pExceptionType:x} throw-ip=0x{(ulong)sample._throwIP:x} " +
+                                 $"catch-ip=0x{(ulong)sample._catchIP:x} handler-ip=0x{(ulong)sample._handlerIP:x} kind={sample._kind} " +
+                                 $"pass1-frames={sample._pass1FrameCount} pass2-frames={sample._pass2FrameCount} funclets={sample._funcletCount} " +
+                                 $"pass1-us={TicksToMicroseconds(sample._pass1Ticks, tickFrequency)} pass2-us={TicksToMicroseconds(sample._pass2Ticks, tickFrequency)} " +
+                                 $"thread={sample._threadId} timestamp={sample._timeStamp}");
+            }
+        }
+
+        private static ulong TicksToMicroseconds(ulong ticks, ulong tickFrequency)
+        {
+            return (tickFrequency != 0) ? (ulong)(ticks * 1000000.0 / tickFrequency) : 0;
+        }
+    }
+}
@@ -210,9 +210,39 @@ namespace System.Runtime
         [RuntimeImport(RuntimeLibrary, "RhGetMemoryInfo")]
         internal static extern void RhGetMemoryInfo(out GCMemoryInfoData info, GCKind kind);
 
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [RuntimeImport(RuntimeLibrary, "RhGetFlushProcessWriteBuffersStats")]
+        internal static extern void RhGetFlushProcessWriteBuffersStats(out ulong flushCount, out ulong totalTimeNs, out ulong maxTimeNs, out ulong fallbackCount);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [RuntimeImport(RuntimeLibrary, "RhGetGCPauseStats")]
+        internal static extern void RhGetGCPauseStats(GCPauseKind kind, out GCPauseStatsData stats);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [RuntimeImport(RuntimeLibrary, "RhGetGCPauseHistogram")]
+        internal static extern unsafe int RhGetGCPauseHistogram(GCPauseKind kind, uint* buckets, int bucketCount);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [RuntimeImport(RuntimeLibrary, "RhGetGCHistory")]
+        internal static extern unsafe int RhGetGCHistory(GCHistoryRecordData* records, int recordCount);
+
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [RuntimeImport(RuntimeLibrary, "RhGetGCJoinStats")]
+        internal static extern unsafe int RhGetGCJoinStats(GCJoinKind kind, GCJoinStatsData* stats, GCJoinHeapStatsData* heapStats, int heapStatsCount);
+
+        // Copies the exception dispatch totals and up to sampleCount of the most recent sampled dispatches,
+        // newest first, when RH_ExceptionProfiling is set. Returns the number of samples copied.
+        [MethodImpl(MethodImplOptions.InternalCall)]
+        [RuntimeImport(RuntimeLibrary, "RhGetExceptionProfile")]
+        internal static extern unsafe int RhGetExceptionProfile(ExceptionProfileStats* stats, ExceptionDispatchRecord* samples, int sampleCount);
+
         [DllImport(RuntimeLibrary, ExactSpelling = true)]
         internal static unsafe extern void RhAllocateNewArray(IntPtr pArrayEEType, uint numElements, uint flags, void* pResult);
 
+        // Takes a heap snapshot into the file at the given UTF-8 path, see src/Native/Runtime/HeapSnapshot.h
+        [DllImport(RuntimeLibrary, ExactSpelling = true)]
+        internal static unsafe extern int RhWriteHeapSnapshot(byte* path);
+
         [MethodImpl(MethodImplOptions.InternalCall)]
         [RuntimeImport(RuntimeLibrary, "RhCompareObjectContentsAndPadding")]
         internal extern static bool RhCompareObjectContentsAndPadding(object obj1, object obj2);
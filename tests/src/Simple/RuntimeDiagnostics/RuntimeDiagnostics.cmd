@@ -0,0 +1,24 @@
+@echo off
+setlocal
+set Report=%1\RuntimeDiagnostics.txt
+set Snapshot=%1\RuntimeDiagnostics.heapsnapshot
+if exist "%Report%" del "%Report%"
+if exist "%Snapshot%" del "%Snapshot%"
+set RH_ExceptionProfiling=1
+"%1\%2" "%Report%" "%Snapshot%"
+IF NOT "%ERRORLEVEL%"=="100" goto fail
+findstr /b /c:"gc-pause kind=blocking-gen2 count=" "%Report%" >nul || goto fail
+findstr /b /c:"gc-pause-histogram kind=blocking-gen2 " "%Report%" >nul || goto fail
+findstr /b /c:"gc-pinned-plugs kind=full-blocking count=" "%Report%" >nul || goto fail
+findstr /b /c:"flush-process-write-buffers count=" "%Report%" >nul || goto fail
+findstr /b /c:"gc-history index=" "%Report%" >nul || goto fail
+findstr /b /c:"gc-join kind=server " "%Report%" >nul || goto fail
+findstr /r /c:"^exception-profile dispatches=[1-9]" "%Report%" >nul || goto fail
+findstr /b /c:"exception-sample " "%Report%" >nul || goto fail
+findstr /r /c:"^heap-snapshot .* written=True$" "%Report%" >nul || goto fail
+for %%F in ("%Snapshot%") do if %%~zF==0 goto fail
+echo %~n0: pass
+EXIT /b 0
+:fail
+echo %~n0: fail
+EXIT /b 1
@@ -0,0 +1,50 @@
+// Licensed to the .NET Foundation under one or more agreements.
+// The .NET Foundation licenses this file to you under the MIT license.
+
+using System;
+using System.Runtime.CompilerServices;
+
+// Exercises the runtime features that the diagnostics report covers. The runtime writes the report when the
+// process exits, so RuntimeDiagnostics.sh/.cmd check its content once this returns.
+internal static class Program
+{
+    private const int Pass = 100;
+    private const int Fail = -1;
+
+    public static int Main(string[] args)
+    {
+        if (args.Length != 2)
+        {
+            Console.WriteLine("Usage: RuntimeDiagnostics <report path> <heap snapshot path>");
+            return Fail;
+        }
+
+        AppContext.SetData("System.Runtime.DiagnosticsReportPath", args[0]);
+        AppContext.SetData("System.Runtime.HeapSnapshotPath", args[1]);
+
+        Console.WriteLine("    Blocking GCs");
+        for (int i = 0; i < 3; i++)
+            GC.Collect();
+        GC.Collect(0);
+
+        Console.WriteLine("    Caught exceptions");
+        for (int i = 0; i < 10; i++)
+        {
+            try
+            {
+                Throw(i);
+            }
+            catch (InvalidOperationException)
+            {
+            }
+        }
+
+        return Pass;
+    }
+
+    [MethodImpl(MethodImplOptions.NoInlining)]
+    private static void Throw(int i)
+    {
+        throw new InvalidOperationException(i.ToString());
+    }
+}
@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+report=$1/RuntimeDiagnostics.txt
+snapshot=$1/RuntimeDiagnostics.heapsnapshot
+rm -f $report $snapshot
+RH_ExceptionProfiling=1 $1/$2 $report $snapshot
+if [ $? == 100 ] &&
+   grep -q "^gc-pause kind=blocking-gen2 count=" $report &&
+   grep -q "^gc-pause-histogram kind=blocking-gen2 " $report &&
+   grep -q "^gc-pinned-plugs kind=full-blocking count=" $report &&
+   grep -q "^flush-process-write-buffers count=" $report &&
+   grep -q "^gc-history index=" $report &&
+   grep -q "^gc-join kind=server " $report &&
+   grep -q "^exception-profile dispatches=[1-9]" $report &&
+   grep -q "^exception-sample " $report &&
+   grep -q "^heap-snapshot .* written=True$" $report &&
+   [ -s $snapshot ]; then
+    echo pass
+    exit 0
+else
+    echo fail
+    exit 1
+fi